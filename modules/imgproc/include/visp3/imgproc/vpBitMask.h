@@ -0,0 +1,109 @@
+/****************************************************************************
+ *
+ * This file is part of the ViSP software.
+ * Copyright (C) 2005 - 2016 by Inria. All rights reserved.
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * ("GPL") version 2 as published by the Free Software Foundation.
+ * See the file LICENSE.txt at the root directory of this source
+ * distribution for additional information about the GNU GPL.
+ *
+ * For using ViSP with software that can not be combined with the GNU
+ * GPL, please contact Inria about acquiring a ViSP Professional
+ * Edition License.
+ *
+ * See http://visp.inria.fr for more information.
+ *
+ * This software was developed at:
+ * Inria Rennes - Bretagne Atlantique
+ * Campus Universitaire de Beaulieu
+ * 35042 Rennes Cedex
+ * France
+ *
+ * If you have questions regarding the use of this file, please contact
+ * Inria at visp@inria.fr
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Description:
+ * Binary mask with 1 bit per pixel.
+ *
+ * Authors:
+ * Souriya Trinh
+ *
+ *****************************************************************************/
+
+/*!
+  \file vpBitMask.h
+  \brief Binary mask with 1 bit per pixel.
+*/
+
+#ifndef __vpBitMask_h__
+#define __vpBitMask_h__
+
+#include <vector>
+#include <visp3/core/vpImage.h>
+
+
+namespace vp
+{
+  /*!
+    \class vpBitMask
+    \ingroup group_imgproc_connected_components
+
+    \brief Binary mask stored with 1 bit per pixel, 8 times smaller than a vpImage<unsigned char> mask.
+
+    Each row starts on a new byte, the pixel (i, j) being the bit j%8 of the byte j/8 of the row i.
+  */
+  class VISP_EXPORT vpBitMask {
+  public:
+    vpBitMask();
+    vpBitMask(const unsigned int height, const unsigned int width);
+
+    void clear();
+    void convert(vpImage<unsigned char> &I, const unsigned char value=255) const;
+
+    /*!
+      \return True if the pixel (i, j) is set.
+    */
+    inline bool get(const unsigned int i, const unsigned int j) const {
+      return ((m_bits[i*m_rowSize + (j >> 3)] >> (j & 7)) & 1) != 0;
+    }
+
+    /*!
+      \return The height of the mask.
+    */
+    inline unsigned int getHeight() const {
+      return m_height;
+    }
+
+    /*!
+      \return The width of the mask.
+    */
+    inline unsigned int getWidth() const {
+      return m_width;
+    }
+
+    void resize(const unsigned int height, const unsigned int width);
+
+    /*!
+      Set the pixel (i, j).
+    */
+    inline void set(const unsigned int i, const unsigned int j) {
+      m_bits[i*m_rowSize + (j >> 3)] |= (unsigned char) (1 << (j & 7));
+    }
+
+    void setRange(const unsigned int i, const unsigned int begin, const unsigned int end);
+
+  private:
+    unsigned int m_height;
+    unsigned int m_width;
+    //! Number of bytes of a row
+    unsigned int m_rowSize;
+    std::vector<unsigned char> m_bits;
+  };
+}
+
+#endif
@@ -0,0 +1,123 @@
+/****************************************************************************
+ *
+ * This file is part of the ViSP software.
+ * Copyright (C) 2005 - 2016 by Inria. All rights reserved.
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * ("GPL") version 2 as published by the Free Software Foundation.
+ * See the file LICENSE.txt at the root directory of this source
+ * distribution for additional information about the GNU GPL.
+ *
+ * For using ViSP with software that can not be combined with the GNU
+ * GPL, please contact Inria about acquiring a ViSP Professional
+ * Edition License.
+ *
+ * See http://visp.inria.fr for more information.
+ *
+ * This software was developed at:
+ * Inria Rennes - Bretagne Atlantique
+ * Campus Universitaire de Beaulieu
+ * 35042 Rennes Cedex
+ * France
+ *
+ * If you have questions regarding the use of this file, please contact
+ * Inria at visp@inria.fr
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Description:
+ * Reusable context for the fast CLAHE method on image sequences.
+ *
+ * Authors:
+ * Souriya Trinh
+ *
+ *****************************************************************************/
+
+/*!
+  \file vpCLAHEContext.h
+  \brief Reusable context for the fast CLAHE method on image sequences.
+*/
+
+#ifndef __vpCLAHEContext_h__
+#define __vpCLAHEContext_h__
+
+#include <vector>
+#include <visp3/core/vpImage.h>
+#include <visp3/core/vpRGBa.h>
+
+
+namespace vp
+{
+  /*!
+    \class vpCLAHEContext
+    \ingroup group_imgproc_brightness
+
+    \brief Apply the fast CLAHE method (see vp::clahe()) on a sequence of images with the same size.
+
+    The parameters are checked, the grid of blocks is computed and all the buffers are allocated once at
+    construction, so that apply() does not perform any heap allocation when the output image has already
+    the right size.
+
+    Optionally, the transfer functions can be smoothed over time with the ones of the previous image to reduce
+    the flickering in video streams, see setTemporalSmoothing().
+  */
+  class VISP_EXPORT vpCLAHEContext {
+  public:
+    vpCLAHEContext(const unsigned int width, const unsigned int height, const int blockRadius=150,
+                   const int bins=256, const float slope=3.0f, const int nbThreads=1);
+
+    void apply(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2);
+    void apply(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2);
+
+    /*!
+      \return The weight of the transfer functions of the previous image.
+    */
+    inline float getTemporalSmoothing() const {
+      return m_temporalSmoothing;
+    }
+
+    /*!
+      \return True if the parameters given at construction are valid.
+    */
+    inline bool isValid() const {
+      return m_valid;
+    }
+
+    void reset();
+    void setTemporalSmoothing(const float smoothing);
+
+  private:
+    void apply(const unsigned char *I1, unsigned char *I2, const unsigned int width, const unsigned int height,
+               const int step, const int nbChannels);
+    bool checkImageSize(const unsigned int width, const unsigned int height) const;
+
+    unsigned int m_width;
+    unsigned int m_height;
+    int m_blockRadius;
+    int m_bins;
+    float m_slope;
+    int m_nbThreads;
+    bool m_valid;
+    //! Weight of the transfer functions of the previous image
+    float m_temporalSmoothing;
+    //! Number of channels of the previous image, 0 if there is no previous image
+    int m_previousNbChannels;
+    //! Bin of each pixel value
+    std::vector<int> m_binLut;
+    //! Centers of the blocks along the columns and the rows
+    std::vector<int> m_cs;
+    std::vector<int> m_rs;
+    //! Weights of the first block center of the tiles for each column and each row
+    std::vector<float> m_columnWeights;
+    std::vector<float> m_rowWeights;
+    //! Per thread scratch histograms
+    std::vector<int> m_histograms;
+    //! Transfer functions of the current and of the previous image
+    std::vector<float> m_transfers;
+    std::vector<float> m_previousTransfers;
+  };
+}
+
+#endif
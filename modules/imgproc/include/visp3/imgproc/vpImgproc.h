@@ -46,9 +46,9 @@
 
 #include <visp3/core/vpImage.h>
 #include <visp3/core/vpImageMorphology.h>
+#include <visp3/imgproc/vpBitMask.h>
 #include <visp3/imgproc/vpContours.h>
-
-#define USE_OLD_FILL_HOLE 0
+#include <visp3/imgproc/vpRunLengthImage.h>
 
 
 namespace vp
@@ -57,6 +57,12 @@ namespace vp
       RETINEX_UNIFORM = 0, RETINEX_LOW = 1, RETINEX_HIGH = 2
   };
 
+  typedef enum {
+    RETINEX_BLUR_KERNEL,    /*!< Gaussian blur with a truncated kernel of kernelSize taps (vpImageFilter::gaussianBlur) */
+    RETINEX_BLUR_RECURSIVE, /*!< Young I.T. and van Vliet L.J. (1995) recursive Gaussian filter, constant cost per pixel */
+    RETINEX_BLUR_PYRAMID    /*!< Recursive Gaussian filter applied on a downsampled Gaussian pyramid level and bilinearly upsampled */
+  } vpRetinexBlurMethod;
+
   typedef enum {
     AUTO_THRESHOLD_HUANG,       /*!< Huang L.-K. and Wang M.-J.J. (1995) "Image Thresholding by Minimizing the Measures of Fuzziness" Pattern Recognition, 28(1): 41-51 \cite Huang_imagethresholding */
     AUTO_THRESHOLD_INTERMODES,  /*!< Prewitt, JMS & Mendelsohn, ML (1966), "The analysis of cell images", Annals of the New York Academy of Sciences 128: 1035-1053 \cite NYAS:NYAS1035 */
@@ -66,18 +72,46 @@ namespace vp
     AUTO_THRESHOLD_TRIANGLE     /*!< Zack GW, Rogers WE, Latt SA (1977), "Automatic measurement of sister chromatid exchange frequency", J. Histochem. Cytochem. 25 (7): 741–53, PMID 70454 \cite doi:10.1177/25.7.70454 */
   } vpAutoThresholdMethod;
 
+  /*!
+    Statistics of the connected components computed by vp::connectedComponentsWithStats(), stored as a structure of
+    arrays: the element k of each array corresponds to the label k+1.
+  */
+  struct vpConnectedComponentsStats {
+    std::vector<unsigned int> m_area;   /*!< Number of pixels. */
+    std::vector<unsigned int> m_top;    /*!< Smallest row of the bounding box. */
+    std::vector<unsigned int> m_left;   /*!< Smallest column of the bounding box. */
+    std::vector<unsigned int> m_bottom; /*!< Largest row of the bounding box. */
+    std::vector<unsigned int> m_right;  /*!< Largest column of the bounding box. */
+    std::vector<double> m_sumI;         /*!< Sum of the rows i of the pixels. */
+    std::vector<double> m_sumJ;         /*!< Sum of the columns j of the pixels. */
+    std::vector<double> m_sumII;        /*!< Sum of i*i, only computed with the second order moments. */
+    std::vector<double> m_sumIJ;        /*!< Sum of i*j, only computed with the second order moments. */
+    std::vector<double> m_sumJJ;        /*!< Sum of j*j, only computed with the second order moments. */
+
+    vpConnectedComponentsStats() :
+      m_area(), m_top(), m_left(), m_bottom(), m_right(), m_sumI(), m_sumJ(), m_sumII(), m_sumIJ(), m_sumJJ() {
+    }
+  };
+
   VISP_EXPORT void adjust(vpImage<unsigned char> &I, const double alpha, const double beta);
   VISP_EXPORT void adjust(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const double alpha, const double beta);
   VISP_EXPORT void adjust(vpImage<vpRGBa> &I, const double alpha, const double beta);
   VISP_EXPORT void adjust(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const double alpha, const double beta);
 
   VISP_EXPORT void clahe(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const int blockRadius=150,
-                         const int bins=256, const float slope=3.0f, const bool fast=true);
+                         const int bins=256, const float slope=3.0f, const bool fast=true,
+                         const int nbThreads=1);
+  VISP_EXPORT void clahe(const vpImage<unsigned short> &I1, vpImage<unsigned short> &I2, const int blockRadius=150,
+                         const int bins=4096, const float slope=3.0f, const bool fast=true,
+                         const int nbThreads=1);
   VISP_EXPORT void clahe(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const int blockRadius=150,
-                         const int bins=256, const float slope=3.0f, const bool fast=true);
+                         const int bins=256, const float slope=3.0f, const bool fast=true,
+                         const int nbThreads=1, const bool useHSV=false);
 
   VISP_EXPORT void equalizeHistogram(vpImage<unsigned char> &I);
   VISP_EXPORT void equalizeHistogram(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2);
+  VISP_EXPORT void equalizeHistogram(vpImage<unsigned short> &I);
+  VISP_EXPORT void equalizeHistogram(const vpImage<unsigned short> &I1, vpImage<unsigned short> &I2);
   VISP_EXPORT void equalizeHistogram(vpImage<vpRGBa> &I, const bool useHSV=false);
   VISP_EXPORT void equalizeHistogram(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const bool useHSV=false);
 
@@ -86,10 +120,24 @@ namespace vp
   VISP_EXPORT void gammaCorrection(vpImage<vpRGBa> &I, const double gamma);
   VISP_EXPORT void gammaCorrection(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const double gamma);
 
+  VISP_EXPORT void retinex(vpImage<unsigned char> &I, const int scale=240, const int scaleDiv=3,
+                           const int level=RETINEX_UNIFORM, const double dynamic=1.2, const int kernelSize=-1,
+                           const vpRetinexBlurMethod &blurMethod=RETINEX_BLUR_KERNEL, const bool useFloat=false,
+                           const int nbThreads=1, const double clipPercent=0.0);
+  VISP_EXPORT void retinex(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const int scale=240,
+                           const int scaleDiv=3, const int level=RETINEX_UNIFORM, const double dynamic=1.2,
+                           const int kernelSize=-1, const vpRetinexBlurMethod &blurMethod=RETINEX_BLUR_KERNEL,
+                           const bool useFloat=false, const int nbThreads=1, const double clipPercent=0.0);
   VISP_EXPORT void retinex(vpImage<vpRGBa> &I, const int scale=240, const int scaleDiv=3,
-                           const int level=RETINEX_UNIFORM, const double dynamic=1.2, const int kernelSize=-1);
+                           const int level=RETINEX_UNIFORM, const double dynamic=1.2, const int kernelSize=-1,
+                           const vpRetinexBlurMethod &blurMethod=RETINEX_BLUR_KERNEL, const bool useFloat=false,
+                           const int nbThreads=1, const double clipPercent=0.0,
+                           const bool intensityOnly=false);
   VISP_EXPORT void retinex(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const int scale=240, const int scaleDiv=3,
-                           const int level=RETINEX_UNIFORM, const double dynamic=1.2, const int kernelSize=-1);
+                           const int level=RETINEX_UNIFORM, const double dynamic=1.2, const int kernelSize=-1,
+                           const vpRetinexBlurMethod &blurMethod=RETINEX_BLUR_KERNEL, const bool useFloat=false,
+                           const int nbThreads=1, const double clipPercent=0.0,
+                           const bool intensityOnly=false);
 
   VISP_EXPORT void stretchContrast(vpImage<unsigned char> &I);
   VISP_EXPORT void stretchContrast(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2);
@@ -107,22 +155,55 @@ namespace vp
                                const unsigned int size=7, const double weight=0.6);
 
   VISP_EXPORT void connectedComponents(const vpImage<unsigned char> &I, vpImage<int> &labels, int &nbComponents,
+                                       const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4,
+                                       const int nbThreads=1);
+  VISP_EXPORT void connectedComponentsMultiValued(const vpImage<unsigned char> &I, vpImage<int> &labels,
+                                                 int &nbComponents, const unsigned char tolerance=0,
+                                                 const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4,
+                                                 const int nbThreads=1);
+  VISP_EXPORT void connectedComponentsWithStats(const vpImage<unsigned char> &I, vpImage<int> &labels, int &nbComponents,
+                                                vpConnectedComponentsStats &stats,
+                                                const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4,
+                                                const bool computeMoments=false, const unsigned int minArea=0,
+                                                const int nbThreads=1);
+  VISP_EXPORT void connectedComponents(const vpRunLengthImage &I, std::vector<int> &labels, int &nbComponents,
                                        const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
 
-  VISP_EXPORT void fillHoles(vpImage<unsigned char> &I
-#if USE_OLD_FILL_HOLE
-                             , const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4
-#endif
-      );
+  VISP_EXPORT void fillHoles(vpImage<unsigned char> &I,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void fillHoles(vpRunLengthImage &I,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+
+  VISP_EXPORT void findContourSeeds(const vpRunLengthImage &I, std::vector<vpImagePoint> &outerSeeds,
+                                    std::vector<vpImagePoint> &holeSeeds,
+                                    const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_8);
 
   VISP_EXPORT void floodFill(vpImage<unsigned char> &I, const vpImagePoint &seedPoint, const unsigned char oldValue, const unsigned char newValue,
                              const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void floodFill(vpImage<unsigned char> &I, const std::vector<vpImagePoint> &seedPoints,
+                             const std::vector<unsigned char> &newValues, vpConnectedComponentsStats &stats,
+                             const unsigned char tolerance=0,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void floodFill(vpImage<unsigned char> &I, const std::vector<vpImagePoint> &seedPoints,
+                             const std::vector<unsigned char> &newValues, vpConnectedComponentsStats &stats,
+                             const unsigned char lowValue, const unsigned char highValue,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void floodFill(const vpImage<unsigned char> &I, vpImage<unsigned char> &mask, const vpImagePoint &seedPoint,
+                             const unsigned char oldValue, const unsigned char maskValue=255,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void floodFill(const vpImage<unsigned char> &I, vpBitMask &mask, const vpImagePoint &seedPoint,
+                             const unsigned char oldValue,
+                             const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
+  VISP_EXPORT void floodFillBorder(const vpImage<unsigned char> &I, vpBitMask &mask, const unsigned char oldValue,
+                                   const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
 
   VISP_EXPORT void reconstruct(const vpImage<unsigned char> &marker, const vpImage<unsigned char> &mask, vpImage<unsigned char> &I,
                                const vpImageMorphology::vpConnexityType &connexity=vpImageMorphology::CONNEXITY_4);
 
   VISP_EXPORT unsigned char autoThreshold(vpImage<unsigned char> &I, const vp::vpAutoThresholdMethod &method, const unsigned char backgroundValue=0,
                                           const unsigned char foregroundValue=255);
+  VISP_EXPORT int autoThreshold(vpImage<unsigned short> &I, const vp::vpAutoThresholdMethod &method,
+                                const unsigned short backgroundValue=0, const unsigned short foregroundValue=65535);
 }
 
 #endif
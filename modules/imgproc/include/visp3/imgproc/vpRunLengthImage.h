@@ -0,0 +1,143 @@
+/****************************************************************************
+ *
+ * This file is part of the ViSP software.
+ * Copyright (C) 2005 - 2016 by Inria. All rights reserved.
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * ("GPL") version 2 as published by the Free Software Foundation.
+ * See the file LICENSE.txt at the root directory of this source
+ * distribution for additional information about the GNU GPL.
+ *
+ * For using ViSP with software that can not be combined with the GNU
+ * GPL, please contact Inria about acquiring a ViSP Professional
+ * Edition License.
+ *
+ * See http://visp.inria.fr for more information.
+ *
+ * This software was developed at:
+ * Inria Rennes - Bretagne Atlantique
+ * Campus Universitaire de Beaulieu
+ * 35042 Rennes Cedex
+ * France
+ *
+ * If you have questions regarding the use of this file, please contact
+ * Inria at visp@inria.fr
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Description:
+ * Run-length encoded binary image.
+ *
+ * Authors:
+ * Souriya Trinh
+ *
+ *****************************************************************************/
+
+/*!
+  \file vpRunLengthImage.h
+  \brief Run-length encoded binary image.
+*/
+
+#ifndef __vpRunLengthImage_h__
+#define __vpRunLengthImage_h__
+
+#include <vector>
+#include <visp3/core/vpImage.h>
+
+
+namespace vp
+{
+  /*!
+    Horizontal run of consecutive foreground pixels [m_begin, m_end[ in the row m_row.
+  */
+  struct vpRun {
+    unsigned int m_row;
+    unsigned int m_begin;
+    unsigned int m_end;
+
+    vpRun() : m_row(0), m_begin(0), m_end(0) {
+    }
+
+    vpRun(const unsigned int row, const unsigned int begin, const unsigned int end) :
+      m_row(row), m_begin(begin), m_end(end) {
+    }
+  };
+
+  /*!
+    \class vpRunLengthImage
+    \ingroup group_imgproc_connected_components
+
+    \brief Binary image stored as the list of its horizontal runs of foreground pixels.
+
+    The runs are sorted in raster order and the runs of a row are contiguous, see getRowRuns(). For sparse masks with
+    large uniform regions, the memory and the processing time are proportional to the number of runs instead of the
+    number of pixels. vp::connectedComponents(), vp::fillHoles() and vp::findContourSeeds() have implementations
+    working directly on the runs.
+  */
+  class VISP_EXPORT vpRunLengthImage {
+  public:
+    vpRunLengthImage();
+    vpRunLengthImage(const unsigned int height, const unsigned int width);
+    explicit vpRunLengthImage(const vpImage<unsigned char> &I);
+
+    void complement(vpRunLengthImage &I) const;
+    void convert(vpImage<unsigned char> &I, const unsigned char foregroundValue=255) const;
+
+    unsigned int getArea() const;
+
+    /*!
+      \return The height of the image.
+    */
+    inline unsigned int getHeight() const {
+      return m_height;
+    }
+
+    /*!
+      \return The number of runs.
+    */
+    inline size_t getNbRuns() const {
+      return m_runs.size();
+    }
+
+    /*!
+      \param row : Row index.
+      \param first : Index of the first run of the row.
+      \param last : Index after the last run of the row.
+    */
+    inline void getRowRuns(const unsigned int row, size_t &first, size_t &last) const {
+      first = m_rowRuns[row];
+      last = m_rowRuns[row + 1];
+    }
+
+    /*!
+      \return The runs in raster order.
+    */
+    inline const std::vector<vpRun> &getRuns() const {
+      return m_runs;
+    }
+
+    /*!
+      \return The width of the image.
+    */
+    inline unsigned int getWidth() const {
+      return m_width;
+    }
+
+    void init(const vpImage<unsigned char> &I);
+    void init(const unsigned int height, const unsigned int width, const std::vector<vpRun> &runs);
+
+  private:
+    void computeRowRuns();
+
+    unsigned int m_height;
+    unsigned int m_width;
+    //! Runs in raster order
+    std::vector<vpRun> m_runs;
+    //! Index of the first run of each row, the last element being the number of runs
+    std::vector<size_t> m_rowRuns;
+  };
+}
+
+#endif
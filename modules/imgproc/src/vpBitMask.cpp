@@ -0,0 +1,129 @@
+/****************************************************************************
+ *
+ * This file is part of the ViSP software.
+ * Copyright (C) 2005 - 2016 by Inria. All rights reserved.
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * ("GPL") version 2 as published by the Free Software Foundation.
+ * See the file LICENSE.txt at the root directory of this source
+ * distribution for additional information about the GNU GPL.
+ *
+ * For using ViSP with software that can not be combined with the GNU
+ * GPL, please contact Inria about acquiring a ViSP Professional
+ * Edition License.
+ *
+ * See http://visp.inria.fr for more information.
+ *
+ * This software was developed at:
+ * Inria Rennes - Bretagne Atlantique
+ * Campus Universitaire de Beaulieu
+ * 35042 Rennes Cedex
+ * France
+ *
+ * If you have questions regarding the use of this file, please contact
+ * Inria at visp@inria.fr
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Description:
+ * Binary mask with 1 bit per pixel.
+ *
+ * Authors:
+ * Souriya Trinh
+ *
+ *****************************************************************************/
+
+/*!
+  \file vpBitMask.cpp
+  \brief Binary mask with 1 bit per pixel.
+*/
+
+#include <cstring>
+#include <visp3/imgproc/vpBitMask.h>
+
+/*!
+  Default constructor, empty mask.
+*/
+vp::vpBitMask::vpBitMask() : m_height(0), m_width(0), m_rowSize(0), m_bits() {
+}
+
+/*!
+  Create a mask with no pixel set.
+
+  \param height : Height of the mask.
+  \param width : Width of the mask.
+*/
+vp::vpBitMask::vpBitMask(const unsigned int height, const unsigned int width) :
+  m_height(0), m_width(0), m_rowSize(0), m_bits() {
+  resize(height, width);
+}
+
+/*!
+  Unset all the pixels.
+*/
+void vp::vpBitMask::clear() {
+  if (!m_bits.empty()) {
+    memset(&m_bits[0], 0, m_bits.size());
+  }
+}
+
+/*!
+  Convert to an image.
+
+  \param I : Output image.
+  \param value : Value of the set pixels, the other pixels are set to 0.
+*/
+void vp::vpBitMask::convert(vpImage<unsigned char> &I, const unsigned char value) const {
+  I.resize(m_height, m_width);
+
+  for (unsigned int i = 0; i < m_height; i++) {
+    const unsigned char *bits = &m_bits[i*m_rowSize];
+    unsigned char *row = I[i];
+    for (unsigned int j = 0; j < m_width; j++) {
+      row[j] = ((bits[j >> 3] >> (j & 7)) & 1) ? value : 0;
+    }
+  }
+}
+
+/*!
+  Resize the mask, all the pixels are unset.
+
+  \param height : Height of the mask.
+  \param width : Width of the mask.
+*/
+void vp::vpBitMask::resize(const unsigned int height, const unsigned int width) {
+  m_height = height;
+  m_width = width;
+  m_rowSize = (width + 7) / 8;
+  m_bits.assign((size_t) m_rowSize * height, 0);
+}
+
+/*!
+  Set the pixels [begin, end[ of the row i.
+
+  \param i : Row index.
+  \param begin : First column.
+  \param end : Column after the last one.
+*/
+void vp::vpBitMask::setRange(const unsigned int i, const unsigned int begin, const unsigned int end) {
+  if (begin >= end) {
+    return;
+  }
+
+  unsigned char *bits = &m_bits[i*m_rowSize];
+  unsigned int firstByte = begin >> 3, lastByte = (end - 1) >> 3;
+  unsigned char firstMask = (unsigned char) (0xFF << (begin & 7));
+  unsigned char lastMask = (unsigned char) (0xFF >> (7 - ((end - 1) & 7)));
+
+  if (firstByte == lastByte) {
+    bits[firstByte] |= (unsigned char) (firstMask & lastMask);
+  } else {
+    bits[firstByte] |= firstMask;
+    if (lastByte > firstByte + 1) {
+      memset(bits + firstByte + 1, 0xFF, lastByte - firstByte - 1);
+    }
+    bits[lastByte] |= lastMask;
+  }
+}
@@ -81,18 +81,34 @@
   \brief Contrast Limited Adaptive Histogram Equalization (CLAHE).
 */
 
+#include <climits>
+#include <limits>
 #include <visp3/imgproc/vpImgproc.h>
-#include <visp3/core/vpImageConvert.h>
+#include <visp3/imgproc/vpCLAHEContext.h>
+
+#if defined VISP_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 namespace {
   int fastRound(const float value) {
     return (int) (value + 0.5f);
   }
 
-  void clipHistogram(const std::vector<int> &hist, std::vector<int> &clippedHist, const int limit) {
-    clippedHist = hist;
+  /*
+    Bin of each pixel value, fastRound(value / maxValue * bins), computed once so that the histogram updates
+    are integer only.
+  */
+  void computeBinLut(const int bins, const int maxValue, std::vector<int> &binLut) {
+    binLut.resize((size_t) maxValue + 1);
+    for (int i = 0; i <= maxValue; i++) {
+      binLut[(size_t) i] = fastRound(i / (float) maxValue * bins);
+    }
+  }
+
+  void clipHistogram(const int *hist, int *clippedHist, const int histlength, const int limit) {
+    std::copy(hist, hist + histlength, clippedHist);
     int clippedEntries = 0, clippedEntriesBefore = 0;
-    int histlength = (int) hist.size();
 
     do {
       clippedEntriesBefore = clippedEntries;
@@ -120,26 +136,39 @@ namespace {
     } while (clippedEntries != clippedEntriesBefore);
   }
 
-  void createHistogram(const int blockRadius, const int bins, const int blockXCenter,
-                       const int blockYCenter, const vpImage<unsigned char> &I,
-                       std::vector<int> &hist) {
-    std::fill(hist.begin(), hist.end(), 0);
+  /*
+    Compute the histograms of the block centered at (blockYCenter, blockXCenter) for the nbChannels first channels
+    of an interleaved image with step bytes per pixel. The histogram of the channel c is stored at c*(bins+1).
+  */
+  template <typename Type>
+  void createHistogram(const int blockRadius, const int bins, const int *binLut, const int blockXCenter,
+                       const int blockYCenter, const Type *I, const int width, const int height,
+                       const int step, const int nbChannels, int *hists) {
+    int histlength = bins + 1;
+    std::fill(hists, hists + nbChannels*histlength, 0);
 
     int xMin = std::max( 0, blockXCenter - blockRadius );
     int yMin = std::max( 0, blockYCenter - blockRadius );
-    int xMax = std::min( (int) I.getWidth(), blockXCenter + blockRadius + 1 );
-    int yMax = std::min( (int) I.getHeight(), blockYCenter + blockRadius + 1 );
+    int xMax = std::min( width, blockXCenter + blockRadius + 1 );
+    int yMax = std::min( height, blockYCenter + blockRadius + 1 );
 
     for (int y = yMin; y < yMax; ++y) {
-      for (int x = xMin; x < xMax; ++x) {
-        ++hist[fastRound(I[y][x] / 255.0f * bins)];
+      const Type *ptr = I + (y * width + xMin) * step;
+      for (int x = xMin; x < xMax; ++x, ptr += step) {
+        for (int c = 0; c < nbChannels; c++) {
+          ++hists[c * histlength + binLut[ptr[c]]];
+        }
       }
     }
   }
 
-  std::vector<float> createTransfer(const std::vector<int> &hist, const int limit, std::vector<int> &cdfs) {
-    clipHistogram(hist, cdfs, limit);
-    int hMin = hist.size() - 1;
+  /*
+    Compute the transfer function of the bins [tableBegin, tableBegin + tableSize[ of the clipped histogram.
+  */
+  void createTransfer(const int *hist, const int histlength, const int limit, int *cdfs, const int tableBegin,
+                      const int tableSize, float *transfer) {
+    clipHistogram(hist, cdfs, histlength, limit);
+    int hMin = histlength - 1;
 
     for (int i = 0; i < hMin; ++i) {
       if (cdfs[i] != 0) {
@@ -147,309 +176,795 @@ namespace {
       }
     }
     int cdf = 0;
-    for (int i = hMin; i < (int) hist.size(); ++i) {
+    for (int i = hMin; i < histlength; ++i) {
       cdf += cdfs[i];
       cdfs[i] = cdf;
     }
 
     int cdfMin = cdfs[hMin];
-    int cdfMax = cdfs[hist.size() - 1];
+    int cdfMax = cdfs[histlength - 1];
+
+    for (int i = 0; i < tableSize; ++i) {
+      transfer[i] = (cdfs[tableBegin + i] - cdfMin) / (float) (cdfMax - cdfMin);
+    }
+  }
 
-    std::vector<float> transfer(hist.size());
-    for (int i = 0; i < (int) transfer.size(); ++i) {
-      transfer[i] = (cdfs[i] - cdfMin) / (float) (cdfMax - cdfMin);
+  //Number of bins lower or equal to v that are incremented when redistributing the remainder
+  //of the clipped entries with a step s (see clipHistogram), s == 0 means no remainder
+  int nbIncrements(const int s, const int v) {
+    if (s == 0 || v < s / 2) {
+      return 0;
     }
 
-    return transfer;
+    return (v - s / 2) / s + 1;
   }
 
-  float transferValue(const int v, std::vector<int> &clippedHist) {
-    int clippedHistLength = clippedHist.size();
-    int hMin = clippedHistLength - 1;
-    for (int i = 0; i < hMin; i++) {
-      if (clippedHist[i] != 0) {
-        hMin = i;
+  //Return 1 if the bin i is incremented when redistributing the remainder with a step s
+  int isIncremented(const int s, const int i) {
+    return (s != 0 && i >= s / 2 && (i - s / 2) % s == 0) ? 1 : 0;
+  }
+
+  //Sum of the redistributed entries for the bin i, after the redistributions given by redistributed
+  //(pairs of quotient and step)
+  int redistributedEntries(const std::vector<std::pair<int, int> > &redistributed, const int i) {
+    int entries = 0;
+    for (size_t k = 0; k < redistributed.size(); k++) {
+      entries += redistributed[k].first + isIncremented(redistributed[k].second, i);
+    }
+
+    return entries;
+  }
+
+  //Value of the bin i of a histogram of histlength bins stored only for the bins [histBegin, histBegin + histSize[,
+  //the other bins are empty
+  int binValue(const int *hist, const int histBegin, const int histSize, const int i) {
+    return (i >= histBegin && i < histBegin + histSize) ? hist[i - histBegin] : 0;
+  }
+
+  /*
+    Compute the transfer value of the bin v for the histogram clipped with clipHistogram(), without building
+    the clipped histogram.
+
+    After k iterations of clipHistogram(), the clipped histogram is equal to:
+    min(hist[i] + A_{k-1}[i], limit) + a_k[i], with a_k[i] the entries redistributed at iteration k and A_k[i]
+    the sum of the entries redistributed during the k first iterations. Only the bins that can be clipped,
+    that is the bins such as hist[i] > limit - max(A_k), have to be visited during the iterations.
+
+    \param hist : Histogram of the current block, stored only for the bins [histBegin, histBegin + histSize[.
+    \param histBegin : First stored bin.
+    \param histSize : Number of stored bins.
+    \param histlength : Number of bins of the histogram (bins+1).
+    \param v : Bin of the current pixel.
+    \param rank : Sum of hist[i] for i <= v.
+    \param total : Sum of hist[i].
+    \param excess : Sum of max(hist[i] - limit, 0).
+    \param limit : Clip limit.
+    \param candidates : Scratch buffer for the bins that can be clipped and their sum of redistributed entries.
+    \param redistributed : Scratch buffer for the quotient and the step of each redistribution.
+    \param coarseHist : If not NULL, sums of the stored bins by groups of (1 << coarseShift) bins, used to skip
+    the groups below the candidate threshold and the empty groups.
+    \param coarseShift : Log2 of the number of bins of a group of coarseHist.
+  */
+  float clippedTransferValue(const int *hist, const int histBegin, const int histSize, const int histlength,
+                             const int v, const int rank, const int total, const int excess, const int limit,
+                             std::vector<std::pair<int, int> > &candidates,
+                             std::vector<std::pair<int, int> > &redistributed,
+                             const int *coarseHist=NULL, const int coarseShift=0) {
+    int clippedEntries = excess, clippedEntriesBefore = 0;
+    //Sum of the quotients and number of redistributions for the iterations done
+    int sumQuotients = 0, nbRedistributions = 0;
+    //All the bins such as hist[i] > threshold are in candidates, with their sum of redistributed entries
+    int threshold = INT_MAX;
+
+    candidates.clear();
+    redistributed.clear();
+
+    int d = 0, s = 0;
+    while (true) {
+      d = clippedEntries / histlength;
+      int m = clippedEntries % histlength;
+      s = m != 0 ? (histlength - 1) / m : 0;
+      redistributed.push_back(std::pair<int, int>(d, s));
+      sumQuotients += d;
+      nbRedistributions++;
+
+      for (size_t j = 0; j < candidates.size(); j++) {
+        candidates[j].second += d + isIncremented(s, candidates[j].first);
+      }
+
+      if (clippedEntries == clippedEntriesBefore) {
+        break;
+      }
+      clippedEntriesBefore = clippedEntries;
+
+      //A bin can be clipped only if hist[i] + sumQuotients + nbRedistributions > limit
+      if (limit - sumQuotients - nbRedistributions < threshold) {
+        threshold = limit - 2 * (sumQuotients + nbRedistributions);
+        candidates.clear();
+        if (coarseHist != NULL && threshold >= 0) {
+          //A bin of a group whose sum is not above the threshold is not above the threshold
+          for (int k = 0; k <= (histSize - 1) >> coarseShift; k++) {
+            if (coarseHist[k] > threshold) {
+              int iEnd = std::min(histSize, (k + 1) << coarseShift);
+              for (int i = k << coarseShift; i < iEnd; i++) {
+                if (hist[i] > threshold) {
+                  candidates.push_back(std::pair<int, int>(histBegin + i, redistributedEntries(redistributed, histBegin + i)));
+                }
+              }
+            }
+          }
+        } else {
+          //The empty bins that are not stored are candidates only when the threshold is negative
+          int iBegin = threshold < 0 ? 0 : histBegin;
+          int iEnd = threshold < 0 ? histlength : histBegin + histSize;
+          for (int i = iBegin; i < iEnd; i++) {
+            if (binValue(hist, histBegin, histSize, i) > threshold) {
+              candidates.push_back(std::pair<int, int>(i, redistributedEntries(redistributed, i)));
+            }
+          }
+        }
+      }
+
+      //Number of entries above the limit for the next iteration
+      clippedEntries = 0;
+      for (size_t j = 0; j < candidates.size(); j++) {
+        int i = candidates[j].first;
+        int h_i = binValue(hist, histBegin, histSize, i);
+        int A_k = candidates[j].second;
+        int a_k = d + isIncremented(s, i);
+
+        if (h_i + A_k - a_k > limit) {
+          //Already clipped, only the last redistributed entries are above the limit
+          clippedEntries += a_k;
+        } else if (h_i + A_k > limit) {
+          clippedEntries += h_i + A_k - limit;
+        }
       }
     }
 
-    int cdf = 0;
-    for (int i = hMin; i <= v; i++) {
-      cdf += clippedHist[i];
+    //Entries removed by the last clipping step
+    int clippedBelowV = 0, clippedAll = 0;
+    for (size_t j = 0; j < candidates.size(); j++) {
+      int i = candidates[j].first;
+      int A_km1 = candidates[j].second - d - isIncremented(s, i);
+      int clipped = std::max(0, binValue(hist, histBegin, histSize, i) + A_km1 - limit);
+      clippedAll += clipped;
+      if (i <= v) {
+        clippedBelowV += clipped;
+      }
     }
 
-    int cdfMax = cdf;
-    for (int i = v + 1; i < clippedHistLength; ++i) {
-      cdfMax += clippedHist[i];
+    //Sum of the redistributed entries for the bins <= v and for all the bins
+    int redistributedBelowV = (v + 1) * sumQuotients;
+    int redistributedAll = histlength * sumQuotients;
+    for (size_t k = 0; k < redistributed.size(); k++) {
+      redistributedBelowV += nbIncrements(redistributed[k].second, v);
+      redistributedAll += nbIncrements(redistributed[k].second, histlength - 1);
     }
 
-    int cdfMin = clippedHist[ hMin ];
-    return (cdf - cdfMin) / (float) (cdfMax - cdfMin);
-  }
+    int cdf = rank + redistributedBelowV - clippedBelowV;
+    int cdfMax = total + redistributedAll - clippedAll;
+
+    //First non empty bin of the clipped histogram, when no quotient has been redistributed the bins before
+    //the first non empty bin of the histogram and before the first incremented bin are empty
+    int hMin = 0;
+    if (sumQuotients == 0) {
+      hMin = histBegin;
+      int groupMask = (1 << coarseShift) - 1;
+      while (hMin < v && hist[hMin - histBegin] == 0) {
+        if (coarseHist != NULL && ((hMin - histBegin) & groupMask) == 0 && coarseHist[(hMin - histBegin) >> coarseShift] == 0) {
+          hMin = std::min(v, hMin + groupMask + 1);
+        } else {
+          hMin++;
+        }
+      }
+      for (size_t k = 0; k < redistributed.size(); k++) {
+        if (redistributed[k].second != 0) {
+          hMin = std::min(hMin, redistributed[k].second / 2);
+        }
+      }
+    }
 
-  float transferValue(const int v, const std::vector<int> &hist, std::vector<int> &clippedHist, const int limit) {
-    clipHistogram(hist, clippedHist, limit);
+    int cdfMin = 0;
+    for (int i = hMin; i < histlength; i++) {
+      int a_k = d + isIncremented(s, i);
+      int A_km1 = redistributedEntries(redistributed, i) - a_k;
+      cdfMin = std::min(binValue(hist, histBegin, histSize, i) + A_km1, limit) + a_k;
+      if (cdfMin != 0) {
+        break;
+      }
+    }
 
-    return transferValue(v, clippedHist);
+    return (cdf - cdfMin) / (float) (cdfMax - cdfMin);
   }
-}
 
-/*!
-  \ingroup group_imgproc_brightness
-  
-   Adjust the contrast of a grayscale image locally using the Contrast Limited Adaptative Histogram Equalization method.
-   The limit parameter allows to limit the slope of the transformation function to prevent the overamplification of noise.
-   This method is a transcription of the CLAHE ImageJ plugin code by Stephan Saalfeld.
+  bool checkParameters(const int blockRadius, const int bins, const int maxBins, const unsigned int width,
+                       const unsigned int height) {
+    if (blockRadius < 0) {
+      std::cerr << "Error: blockRadius < 0!" << std::endl;
+      return false;
+    }
 
-   \param I1 : The first grayscale image.
-   \param I2 : The second grayscale image after application of the CLAHE method.
-   \param blockRadius : The size (2*blockRadius+1) of the local region around a pixel for which the histogram is equalized.
-   This size should be larger than the size of features to be preserved.
-   \param bins : The number of histogram bins used for histogram equalization (between 1 and 256).
-   The number of histogram bins should be smaller than the number of pixels in a block.
-   \param slope : Limits the contrast stretch in the intensity transfer function.
-   Very large values will let the histogram equalization do whatever it wants to do, that is result in maximal local contrast.
-   The value 1 will result in the original image.
-   \param fast : Use the fast but less accurate version of the filter. The fast version does not evaluate the intensity
-   transfer function for each pixel independently but for a grid of adjacent boxes of the given block size only
-   and interpolates for locations in between.
-*/
-void vp::clahe(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const int blockRadius,
-               const int bins, const float slope, const bool fast) {
-  if (blockRadius < 0) {
-    std::cerr << "Error: blockRadius < 0!" << std::endl;
-    return;
-  }
+    if (bins < 0 || bins > maxBins) {
+      std::cerr << "Error: (bins < 0 || bins > " << maxBins << ")!" << std::endl;
+      return false;
+    }
 
-  if (bins < 0 || bins > 256) {
-    std::cerr << "Error: (bins < 0 || bins > 256)!" << std::endl;
-    return;
-  }
+    if ((unsigned int) (2*blockRadius+1) > width || (unsigned int) (2*blockRadius+1) > height) {
+      std::cerr << "Error: (unsigned int) (2*blockRadius+1) > I1.getWidth() || (unsigned int) (2*blockRadius+1) > I1.getHeight()!" << std::endl;
+      return false;
+    }
 
-  if ((unsigned int) (2*blockRadius+1) > I1.getWidth() || (unsigned int) (2*blockRadius+1) > I1.getHeight()) {
-    std::cerr << "Error: (unsigned int) (2*blockRadius+1) > I1.getWidth() || (unsigned int) (2*blockRadius+1) > I1.getHeight()!" << std::endl;
-    return;
+    return true;
   }
 
-  I2.resize(I1.getHeight(), I1.getWidth());
-
-  if (fast) {
+  /*
+    Compute the centers of the blocks along one dimension of the image for the fast CLAHE.
+  */
+  void computeBlockCenters(const int size, const int blockRadius, std::vector<int> &centers) {
     int blockSize = 2 * blockRadius + 1;
-    int limit = (int)( slope * blockSize * blockSize / bins + 0.5 );
-
     /* div */
-    int nc = I1.getWidth() / blockSize;
-    int nr = I1.getHeight() / blockSize;
-
+    int nb = size / blockSize;
     /* % */
-    int cm = I1.getWidth() - nc * blockSize;
-    std::vector<int> cs;
+    int remainder = size - nb * blockSize;
 
-    switch (cm) {
+    switch (remainder) {
     case 0:
-      cs.resize(nc);
-      for (int i = 0; i < nc; ++i) {
-        cs[i] = i * blockSize + blockRadius + 1;
+      centers.resize((size_t) nb);
+      for (int i = 0; i < nb; ++i) {
+        centers[(size_t) i] = i * blockSize + blockRadius + 1;
       }
       break;
 
     case 1:
-      cs.resize(nc + 1);
-      for (int i = 0; i < nc; ++i) {
-        cs[i] = i * blockSize + blockRadius + 1;
+      centers.resize((size_t) (nb + 1));
+      for (int i = 0; i < nb; ++i) {
+        centers[(size_t) i] = i * blockSize + blockRadius + 1;
       }
-      cs[nc] = I1.getWidth() - blockRadius - 1;
+      centers[(size_t) nb] = size - blockRadius - 1;
       break;
 
     default:
-      cs.resize(nc + 2);
-      cs[0] = blockRadius + 1;
-      for (int i = 0; i < nc; ++i) {
-        cs[i + 1] = i * blockSize + blockRadius + 1 + cm / 2;
+      centers.resize((size_t) (nb + 2));
+      centers[0] = blockRadius + 1;
+      for (int i = 0; i < nb; ++i) {
+        centers[(size_t) (i + 1)] = i * blockSize + blockRadius + 1 + remainder / 2;
       }
-      cs[nc + 1] = I1.getWidth() - blockRadius - 1;
+      centers[(size_t) (nb + 1)] = size - blockRadius - 1;
     }
+  }
 
-    int rm = I1.getHeight() - nr * blockSize;
-    std::vector<int> rs;
-
-    switch (rm) {
-    case 0:
-      rs.resize((size_t) nr);
-      for (int i = 0; i < nr; ++i) {
-        rs[i] = i * blockSize + blockRadius + 1;
-      }
-      break;
+  /*
+    Compute the transfer functions of the grid of blocks centered at (rs, cs) for the nbChannels first channels
+    of an interleaved image with step values per pixel. Only the bins [tableBegin, tableBegin + tableSize[ of the
+    transfer functions are kept, the transfer function of the channel c of the block i is stored at
+    (i*nbChannels + c)*tableSize in transfers. The scratch buffer histograms must hold
+    nbThreads*(nbChannels+1)*(bins+1) elements.
+  */
+  template <typename Type>
+  void computeTransfers(const Type *I1, const int width, const int height, const int step,
+                        const int nbChannels, const int blockRadius, const int bins, const int *binLut,
+                        const int tableBegin, const int tableSize, const float slope, const std::vector<int> &cs,
+                        const std::vector<int> &rs, std::vector<int> &histograms, std::vector<float> &transfers,
+                        const int nbThreads) {
+    int blockSize = 2 * blockRadius + 1;
+    int limit = (int)( slope * blockSize * blockSize / bins + 0.5 );
+    int histlength = bins + 1;
+    int nbRows = (int) rs.size(), nbCols = (int) cs.size();
 
-    case 1:
-      rs.resize((size_t) (nr + 1));
-      for (int i = 0; i < nr; ++i) {
-        rs[i] = i * blockSize + blockRadius + 1;
-      }
-      rs[nr] = I1.getHeight() - blockRadius - 1;
-      break;
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel num_threads(nbThreads)
+#else
+    (void) nbThreads;
+#endif
+    {
+#if defined VISP_HAVE_OPENMP
+      int *hists = &histograms[(size_t) (omp_get_thread_num() * (nbChannels+1) * histlength)];
+#else
+      int *hists = &histograms[0];
+#endif
+      int *cdfs = hists + nbChannels*histlength;
 
-    default:
-      rs.resize((size_t) (nr + 2));
-      rs[0] = blockRadius + 1;
-      for (int i = 0; i < nr; ++i) {
-        rs[i + 1] = i * blockSize + blockRadius + 1 + rm / 2;
+#if defined VISP_HAVE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (int i = 0; i < nbRows*nbCols; i++) {
+        createHistogram(blockRadius, bins, binLut, cs[(size_t) (i % nbCols)], rs[(size_t) (i / nbCols)], I1, width,
+                        height, step, nbChannels, hists);
+        for (int c = 0; c < nbChannels; c++) {
+          createTransfer(hists + c*histlength, histlength, limit, cdfs, tableBegin, tableSize,
+                         &transfers[(size_t) (i*nbChannels + c) * (size_t) tableSize]);
+        }
       }
-      rs[nr + 1] = I1.getHeight() - blockRadius - 1;
     }
+  }
 
-    std::vector<int> hist((size_t) (bins+1));
-    std::vector<int> cdfs((size_t) (bins+1));
-    std::vector<float> tl;
-    std::vector<float> tr;
-    std::vector<float> br;
-    std::vector<float> bl;
-
-    for (int r = 0; r <= (int) rs.size(); ++r) {
-      int r0 = std::max(0, r - 1);
-      int r1 = std::min((int) rs.size() - 1, r);
-      int dr = rs[r1] - rs[r0];
-
-      createHistogram(blockRadius, bins, cs[0], rs[r0], I1, hist);
-      tr = createTransfer(hist, limit, cdfs);
-      if (r0 == r1) {
-        br = tr;
-      } else {
-        createHistogram(blockRadius, bins, cs[0], rs[r1], I1, hist);
-        br = createTransfer(hist, limit, cdfs);
+  /*
+    Compute for each coordinate along one dimension of the image the weight of the first block center of the tile
+    containing the coordinate, 0 when the tile is on the border and there is only one block center.
+  */
+  void computeWeights(const int size, const std::vector<int> &centers, std::vector<float> &weights) {
+    int nb = (int) centers.size();
+    weights.resize((size_t) size);
+
+    for (int c = 0; c <= nb; c++) {
+      int c0 = std::max(0, c - 1);
+      int c1 = std::min(nb - 1, c);
+      int dc = centers[(size_t) c1] - centers[(size_t) c0];
+      int xMin = (c == 0 ? 0 : centers[(size_t) c0]);
+      int xMax = (c < nb ? centers[(size_t) c1] : size);
+
+      for (int x = xMin; x < xMax; x++) {
+        weights[(size_t) x] = c0 == c1 ? 0.0f : (float) (centers[(size_t) c1] - x) / dc;
       }
+    }
+  }
 
-      int yMin = (r == 0 ? 0 : rs[r0]);
-      int yMax = (r < (int) rs.size() ? rs[r1] : I1.getHeight());
+  int clampTransfer(const float t, const int maxValue) {
+    return std::max( 0, std::min(maxValue, fastRound(t * maxValue)) );
+  }
 
-      for (int c = 0; c <= (int) cs.size(); ++c) {
-        int c0 = std::max(0, c - 1);
-        int c1 = std::min((int) cs.size() - 1, c);
-        int dc = cs[c1] - cs[c0];
+  /*
+    Interpolate the transfer functions computed with computeTransfers() for each pixel, tableIndex gives the index
+    in the transfer functions of each pixel value. The weights of the block centers are given per column and per row
+    by computeWeights(). The remaining channels of the interleaved image are copied.
+  */
+  template <typename Type>
+  void interpolateTransfers(const Type *I1, Type *I2, const int width, const int height, const int step,
+                            const int nbChannels, const int *tableIndex, const int tableSize,
+                            const std::vector<int> &cs, const std::vector<int> &rs,
+                            const std::vector<float> &columnWeights, const std::vector<float> &rowWeights,
+                            const std::vector<float> &transfers, const int nbThreads) {
+    int nbRows = (int) rs.size(), nbCols = (int) cs.size();
+    int maxValue = std::numeric_limits<Type>::max();
+
+    //Interpolate the transfer functions for each tile between the block centers,
+    //tiles are independent and are processed in parallel
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nbThreads)
+#else
+    (void) nbThreads;
+#endif
+    for (int tile = 0; tile < (nbRows+1)*(nbCols+1); tile++) {
+      int r = tile / (nbCols+1);
+      int c = tile % (nbCols+1);
 
-        tl = tr;
-        bl = br;
+      int r0 = std::max(0, r - 1);
+      int r1 = std::min(nbRows - 1, r);
+      int c0 = std::max(0, c - 1);
+      int c1 = std::min(nbCols - 1, c);
+
+      int yMin = (r == 0 ? 0 : rs[(size_t) r0]);
+      int yMax = (r < nbRows ? rs[(size_t) r1] : height);
+      int xMin = (c == 0 ? 0 : cs[(size_t) c0]);
+      int xMax = (c < nbCols ? cs[(size_t) c1] : width);
+      int n = xMax - xMin;
+      const float *wx = &columnWeights[(size_t) xMin];
+
+      for (int channel = 0; channel < nbChannels; channel++) {
+        const float *tl = &transfers[(size_t) ((r0*nbCols + c0)*nbChannels + channel) * (size_t) tableSize];
+        const float *tr = &transfers[(size_t) ((r0*nbCols + c1)*nbChannels + channel) * (size_t) tableSize];
+        const float *bl = &transfers[(size_t) ((r1*nbCols + c0)*nbChannels + channel) * (size_t) tableSize];
+        const float *br = &transfers[(size_t) ((r1*nbCols + c1)*nbChannels + channel) * (size_t) tableSize];
 
-        if (c0 != c1) {
-          createHistogram(blockRadius, bins, cs[c1], rs[r0], I1, hist);
-          tr = createTransfer(hist, limit, cdfs);
-          if (r0 == r1) {
-            br = tr;
+        for (int y = yMin; y < yMax; ++y) {
+          float wy = rowWeights[(size_t) y];
+          const Type *src = I1 + (y * width + xMin) * step + channel;
+          Type *dst = I2 + (y * width + xMin) * step + channel;
+
+          //The cases with only one block center along a dimension are on the image borders
+          if (r0 == r1 && c0 == c1) {
+            for (int x = 0; x < n; x++) {
+              dst[x*step] = (Type) clampTransfer(tl[tableIndex[src[x*step]]], maxValue);
+            }
+          } else if (c0 == c1) {
+            for (int x = 0; x < n; x++) {
+              int v = tableIndex[src[x*step]];
+              dst[x*step] = (Type) clampTransfer(wy * tl[v] + (1.0f - wy) * bl[v], maxValue);
+            }
+          } else if (r0 == r1) {
+            for (int x = 0; x < n; x++) {
+              int v = tableIndex[src[x*step]];
+              dst[x*step] = (Type) clampTransfer(wx[x] * tl[v] + (1.0f - wx[x]) * tr[v], maxValue);
+            }
           } else {
-            createHistogram(blockRadius, bins, cs[c1], rs[r1], I1, hist);
-            br = createTransfer(hist, limit, cdfs);
+            for (int x = 0; x < n; x++) {
+              int v = tableIndex[src[x*step]];
+              float t0 = wx[x] * tl[v] + (1.0f - wx[x]) * tr[v];
+              float t1 = wx[x] * bl[v] + (1.0f - wx[x]) * br[v];
+              dst[x*step] = (Type) clampTransfer(wy * t0 + (1.0f - wy) * t1, maxValue);
+            }
           }
         }
+      }
 
-        int xMin = (c == 0 ? 0 : cs[c0]);
-        int xMax = (c < (int) cs.size() ? cs[c1] : I1.getWidth());
+      //Copy the channels not processed (alpha)
+      for (int channel = nbChannels; channel < step; channel++) {
         for (int y = yMin; y < yMax; ++y) {
-          float wy = (float) (rs[r1] - y) / dr;
-
-          for (int x = xMin; x < xMax; ++x) {
-            float wx = (float) (cs[c1] - x) / dc;
-            int v = fastRound(I1[y][x] / 255.0f * bins);
-            float t00 = tl[v];
-            float t01 = tr[v];
-            float t10 = bl[v];
-            float t11 = br[v];
-            float t0 = 0.0f, t1 = 0.0f;
-
-            if (c0 == c1) {
-              t0 = t00;
-              t1 = t10;
-            } else {
-              t0 = wx * t00 + (1.0f - wx) * t01;
-              t1 = wx * t10 + (1.0f - wx) * t11;
-            }
-
-            float t = (r0 == r1) ? t0 : wy * t0 + (1.0f - wy) * t1;
-            I2[y][x] = std::max( 0, std::min(255, fastRound(t * 255.0f)) );
+          const Type *src = I1 + (y * width + xMin) * step + channel;
+          Type *dst = I2 + (y * width + xMin) * step + channel;
+          for (int x = xMin; x < xMax; ++x, src += step, dst += step) {
+            *dst = *src;
           }
         }
       }
     }
-  } else {
-    std::vector<int> hist(bins+1), prev_hist(bins+1);
-    std::vector<int> clippedHist(bins+1);
-
-    bool first = true;
-    int xMin0 = 0;
-    int xMax0 = std::min((int) I1.getWidth(), blockRadius);
+  }
 
-    for (int y = 0; y < (int) I1.getHeight(); y++) {
-      int yMin = std::max(0, y - (int) blockRadius);
-      int yMax = std::min((int) I1.getHeight(), y + blockRadius + 1);
-      int h = yMax - yMin;
+  /*
+    Fast CLAHE on the nbChannels first channels of an interleaved image with step values per pixel.
+    The remaining channels are copied. Only the bins [tableBegin, tableBegin + tableSize[ are used by the image.
+  */
+  template <typename Type>
+  void claheFast(const Type *I1, Type *I2, const int width, const int height, const int step, const int nbChannels,
+                 const int blockRadius, const int bins, const int *binLut, const int *tableIndex,
+                 const int tableBegin, const int tableSize, const float slope, const int nbThreads) {
+    std::vector<int> cs, rs;
+    computeBlockCenters(width, blockRadius, cs);
+    computeBlockCenters(height, blockRadius, rs);
+
+    //Compute once the transfer function of each block of the grid
+    std::vector<int> histograms((size_t) (nbThreads * (nbChannels+1) * (bins+1)));
+    std::vector<float> transfers(rs.size() * cs.size() * (size_t) nbChannels * (size_t) tableSize);
+    computeTransfers(I1, width, height, step, nbChannels, blockRadius, bins, binLut, tableBegin, tableSize, slope,
+                     cs, rs, histograms, transfers, nbThreads);
+
+    std::vector<float> columnWeights, rowWeights;
+    computeWeights(width, cs, columnWeights);
+    computeWeights(height, rs, rowWeights);
+    interpolateTransfers(I1, I2, width, height, step, nbChannels, tableIndex, tableSize, cs, rs, columnWeights,
+                         rowWeights, transfers, nbThreads);
+  }
 
-#if 0
-      std::fill(hist.begin(), hist.end(), 0);
-      // Compute histogram for the current block
-      for (int yi = yMin; yi < yMax; yi++) {
-        for (int xi = xMin0; xi < xMax0; xi++) {
-          ++hist[fastRound(I1[yi][xi] / 255.0f * bins)];
+  /*
+    Exact CLAHE for the rows [yBegin, yEnd[ of the nbChannels first channels of an interleaved image with step values
+    per pixel, the remaining channels are copied. The sliding histograms are seeded at the first row of the band
+    so bands are independent and the result does not depend on the band decomposition. The histograms are stored
+    only for the bins [tableBegin, tableBegin + tableSize[ used by the image, tableIndex gives the index of each
+    pixel value in this range.
+  */
+  template <typename Type>
+  void claheExact(const Type *I1, Type *I2, const int width, const int height, const int step,
+                  const int nbChannels, const int blockRadius, const int bins, const int *tableIndex,
+                  const int tableBegin, const int tableSize, const float slope, const int yBegin, const int yEnd) {
+    //Perreault and Hebert sliding histograms: one histogram per column for the rows of the current block,
+    //the histogram of the block is updated by adding the entering column and removing the leaving column
+    int histlength = bins + 1;
+    int maxValue = std::numeric_limits<Type>::max();
+    //Column histograms of the channel c are stored at c*columnsLength
+    int columnsLength = (width + 1) * tableSize;
+    std::vector<int> columnHists((size_t) nbChannels * (size_t) columnsLength, 0);
+    std::vector<std::vector<int> > hists((size_t) nbChannels, std::vector<int>((size_t) tableSize));
+    std::vector<std::pair<int, int> > candidates;
+    std::vector<std::pair<int, int> > redistributed;
+
+    int yMin = std::max(0, yBegin - blockRadius);
+    int yMax = std::min(height, yBegin + blockRadius + 1);
+    for (int yi = yMin; yi < yMax; yi++) {
+      const Type *ptr = I1 + yi * width * step;
+      for (int xi = 0; xi < width; xi++, ptr += step) {
+        for (int c = 0; c < nbChannels; c++) {
+          ++columnHists[(size_t) c * columnsLength + (size_t) (xi * tableSize + tableIndex[ptr[c]])];
         }
       }
-#else
-      if (first) {
-        first = false;
-        // Compute histogram for the block at (0,0)
-        for (int yi = yMin; yi < yMax; yi++) {
-          for (int xi = xMin0; xi < xMax0; xi++) {
-            ++hist[fastRound(I1[yi][xi] / 255.0f * bins)];
+    }
+
+    for (int y = yBegin; y < yEnd; y++) {
+      if (y > yBegin) {
+        if (y - blockRadius > 0) {
+          // Sliding column histograms, remove top
+          const Type *ptr = I1 + yMin * width * step;
+          for (int xi = 0; xi < width; xi++, ptr += step) {
+            for (int c = 0; c < nbChannels; c++) {
+              --columnHists[(size_t) c * columnsLength + (size_t) (xi * tableSize + tableIndex[ptr[c]])];
+            }
           }
         }
-      } else {
-        hist = prev_hist;
 
-        if (yMin > 0) {
-          int yMin1 = yMin - 1;
-          // Sliding histogram, remove top
-          for (int xi = xMin0; xi < xMax0; xi++) {
-            --hist[fastRound(I1[yMin1][xi] / 255.0f * bins)];
+        if (y + blockRadius + 1 <= height) {
+          // Sliding column histograms, add bottom
+          const Type *ptr = I1 + (y + blockRadius) * width * step;
+          for (int xi = 0; xi < width; xi++, ptr += step) {
+            for (int c = 0; c < nbChannels; c++) {
+              ++columnHists[(size_t) c * columnsLength + (size_t) (xi * tableSize + tableIndex[ptr[c]])];
+            }
           }
         }
 
-        if (y + blockRadius + 1 <= (int) I1.getHeight()) {
-          int yMax1 = yMax - 1;
-          // Sliding histogram, add bottom
-          for (int xi = xMin0; xi < xMax0; xi++) {
-            ++hist[fastRound(I1[yMax1][xi] / 255.0f * bins)];
+        yMin = std::max(0, y - blockRadius);
+        yMax = std::min(height, y + blockRadius + 1);
+      }
+      int h = yMax - yMin;
+
+      // Histograms of the block at (y,-1), the block at (y,0) is obtained when adding the column blockRadius
+      for (int c = 0; c < nbChannels; c++) {
+        std::vector<int> &hist = hists[(size_t) c];
+        std::fill(hist.begin(), hist.end(), 0);
+        for (int xi = 0; xi < blockRadius; xi++) {
+          const int *column = &columnHists[(size_t) c * columnsLength + (size_t) (xi * tableSize)];
+          for (int i = 0; i < tableSize; i++) {
+            hist[(size_t) i] += column[i];
           }
         }
       }
-      prev_hist = hist;
-#endif
 
-      for (int x = 0; x < (int) I1.getWidth(); x++) {
-        int xMin = std::max(0, x - (int) blockRadius);
+      const Type *src = I1 + y * width * step;
+      Type *dst = I2 + y * width * step;
+      for (int x = 0; x < width; x++, src += step, dst += step) {
+        int xMin = std::max(0, x - blockRadius);
         int xMax = x + blockRadius + 1;
 
-        if (xMin > 0) {
-          int xMin1 = xMin - 1;
-          // Sliding histogram, remove left
-          for (int yi = yMin; yi < yMax; yi++) {
-            --hist[fastRound(I1[yi][xMin1] / 255.0f * bins)];
+        int w = std::min(width, xMax) - xMin;
+        int n = h*w;
+        int limit = (int) (slope * n / bins + 0.5f);
+
+        for (int c = 0; c < nbChannels; c++) {
+          std::vector<int> &hist = hists[(size_t) c];
+          const int *columns = &columnHists[(size_t) c * columnsLength];
+          //Empty column histogram used when no column enters or leaves the block
+          const int *emptyColumn = columns + width * tableSize;
+          const int *addedColumn = xMax <= width ? columns + (xMax - 1) * tableSize : emptyColumn;
+          const int *removedColumn = xMin > 0 ? columns + (xMin - 1) * tableSize : emptyColumn;
+
+          int vi = tableIndex[src[c]];
+
+          // Sliding histogram, and in the same pass: cumulative value at v and entries above the limit
+          int rank = 0, excess = 0;
+          for (int i = 0; i <= vi; i++) {
+            hist[(size_t) i] += addedColumn[i] - removedColumn[i];
+            rank += hist[(size_t) i];
+            excess += std::max(0, hist[(size_t) i] - limit);
+          }
+          for (int i = vi + 1; i < tableSize; i++) {
+            hist[(size_t) i] += addedColumn[i] - removedColumn[i];
+            excess += std::max(0, hist[(size_t) i] - limit);
           }
+
+          float t = clippedTransferValue(&hist[0], tableBegin, tableSize, histlength, tableBegin + vi, rank, n,
+                                         excess, limit, candidates, redistributed);
+          dst[c] = (Type) fastRound(t * maxValue);
+        }
+
+        //Copy the channels not processed (alpha)
+        for (int c = nbChannels; c < step; c++) {
+          dst[c] = src[c];
         }
+      }
+    }
+  }
+
+  /*
+    Exact CLAHE for the rows [yBegin, yEnd[ when the range of bins used by the image is large (16-bit images). The
+    column histograms of claheExact() would need (width+1)*tableSize entries per channel, so the histogram of the
+    block is instead updated with the pixels of the entering and leaving columns. A coarse histogram with one entry
+    per group of (1 << coarseShift) bins allows to compute the rank and the excess, and to search the candidates of
+    the clipping, without visiting the groups that are empty or below the clip limit.
+  */
+  template <typename Type>
+  void claheExactCompact(const Type *I1, Type *I2, const int width, const int height, const int step,
+                         const int nbChannels, const int blockRadius, const int bins, const int *tableIndex,
+                         const int tableBegin, const int tableSize, const float slope, const int yBegin,
+                         const int yEnd) {
+    const int coarseShift = 6;
+    int histlength = bins + 1;
+    int maxValue = std::numeric_limits<Type>::max();
+    int coarseSize = ((tableSize - 1) >> coarseShift) + 1;
+    std::vector<std::vector<int> > hists((size_t) nbChannels, std::vector<int>((size_t) tableSize));
+    std::vector<std::vector<int> > coarseHists((size_t) nbChannels, std::vector<int>((size_t) coarseSize));
+    std::vector<std::pair<int, int> > candidates;
+    std::vector<std::pair<int, int> > redistributed;
+
+    for (int y = yBegin; y < yEnd; y++) {
+      int yMin = std::max(0, y - blockRadius);
+      int yMax = std::min(height, y + blockRadius + 1);
+      int h = yMax - yMin;
 
-        if (xMax <= (int) I1.getWidth()) {
-          int xMax1 = xMax - 1;
-          // Sliding histogram, add right
-          for (int yi = yMin; yi < yMax; yi++) {
-            ++hist[fastRound(I1[yi][xMax1] / 255.0f * bins)];
+      // Histograms of the block at (y,-1), the block at (y,0) is obtained when adding the column blockRadius
+      for (int c = 0; c < nbChannels; c++) {
+        std::fill(hists[(size_t) c].begin(), hists[(size_t) c].end(), 0);
+        std::fill(coarseHists[(size_t) c].begin(), coarseHists[(size_t) c].end(), 0);
+      }
+      for (int yi = yMin; yi < yMax; yi++) {
+        const Type *ptr = I1 + yi * width * step;
+        for (int xi = 0; xi < blockRadius; xi++, ptr += step) {
+          for (int c = 0; c < nbChannels; c++) {
+            int i = tableIndex[ptr[c]];
+            ++hists[(size_t) c][(size_t) i];
+            ++coarseHists[(size_t) c][(size_t) (i >> coarseShift)];
           }
         }
+      }
+
+      const Type *src = I1 + y * width * step;
+      Type *dst = I2 + y * width * step;
+      for (int x = 0; x < width; x++, src += step, dst += step) {
+        int xMin = std::max(0, x - blockRadius);
+        int xMax = x + blockRadius + 1;
 
-        int v = fastRound(I1[y][x] / 255.0f * bins);
-        int w = std::min((int) I1.getWidth(), xMax) - xMin;
+        int w = std::min(width, xMax) - xMin;
         int n = h*w;
         int limit = (int) (slope * n / bins + 0.5f);
-        I2[y][x] = fastRound(transferValue(v, hist, clippedHist, limit) * 255.0f);
+
+        for (int c = 0; c < nbChannels; c++) {
+          int *hist = &hists[(size_t) c][0];
+          int *coarseHist = &coarseHists[(size_t) c][0];
+
+          // Sliding histogram, add the entering column and remove the leaving column
+          if (xMax <= width) {
+            const Type *ptr = I1 + (yMin * width + xMax - 1) * step + c;
+            for (int yi = yMin; yi < yMax; yi++, ptr += width * step) {
+              int i = tableIndex[*ptr];
+              ++hist[i];
+              ++coarseHist[i >> coarseShift];
+            }
+          }
+          if (xMin > 0) {
+            const Type *ptr = I1 + (yMin * width + xMin - 1) * step + c;
+            for (int yi = yMin; yi < yMax; yi++, ptr += width * step) {
+              int i = tableIndex[*ptr];
+              --hist[i];
+              --coarseHist[i >> coarseShift];
+            }
+          }
+
+          int vi = tableIndex[src[c]];
+
+          // Cumulative value at v and entries above the limit, a group whose sum is not above the limit has no excess
+          int rank = 0, excess = 0;
+          for (int k = 0; k < (vi >> coarseShift); k++) {
+            rank += coarseHist[k];
+          }
+          for (int i = (vi >> coarseShift) << coarseShift; i <= vi; i++) {
+            rank += hist[i];
+          }
+          for (int k = 0; k < coarseSize; k++) {
+            if (coarseHist[k] > limit) {
+              int iEnd = std::min(tableSize, (k + 1) << coarseShift);
+              for (int i = k << coarseShift; i < iEnd; i++) {
+                excess += std::max(0, hist[i] - limit);
+              }
+            }
+          }
+
+          float t = clippedTransferValue(hist, tableBegin, tableSize, histlength, tableBegin + vi, rank, n,
+                                         excess, limit, candidates, redistributed, coarseHist, coarseShift);
+          dst[c] = (Type) fastRound(t * maxValue);
+        }
+
+        //Copy the channels not processed (alpha)
+        for (int c = nbChannels; c < step; c++) {
+          dst[c] = src[c];
+        }
+      }
+    }
+  }
+
+  /*
+    CLAHE on the nbChannels first channels of an interleaved image with step values per pixel.
+  */
+  template <typename Type>
+  void claheInterleaved(const Type *I1, Type *I2, const int width, const int height, const int step,
+                        const int nbChannels, const int blockRadius, const int bins, const float slope,
+                        const bool fast, const int nbThreads) {
+#if defined VISP_HAVE_OPENMP
+    int nbThreads_ = nbThreads > 0 ? nbThreads : omp_get_max_threads();
+#else
+    int nbThreads_ = 1;
+    (void) nbThreads;
+#endif
+
+    int maxValue = std::numeric_limits<Type>::max();
+    std::vector<int> binLut;
+    computeBinLut(bins, maxValue, binLut);
+
+    //Range of the bins used by the image, the histograms and the transfer functions are stored only for this range
+    Type minPixel = std::numeric_limits<Type>::max(), maxPixel = 0;
+    for (int i = 0; i < width*height; i++) {
+      for (int c = 0; c < nbChannels; c++) {
+        minPixel = std::min(minPixel, I1[i*step + c]);
+        maxPixel = std::max(maxPixel, I1[i*step + c]);
+      }
+    }
+
+    int tableBegin = binLut[(size_t) minPixel];
+    int tableSize = binLut[(size_t) maxPixel] - tableBegin + 1;
+    std::vector<int> tableIndex((size_t) maxValue + 1);
+    for (int i = 0; i <= maxValue; i++) {
+      tableIndex[(size_t) i] = binLut[(size_t) i] - tableBegin;
+    }
+
+    if (fast) {
+      claheFast(I1, I2, width, height, step, nbChannels, blockRadius, bins, &binLut[0], &tableIndex[0], tableBegin,
+                tableSize, slope, nbThreads_);
+    } else {
+      //Split the image into horizontal bands processed independently
+      int nbBands = std::max(1, std::min(nbThreads_, height));
+      int bandHeight = (height + nbBands - 1) / nbBands;
+
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbThreads_)
+#endif
+      for (int band = 0; band < nbBands; band++) {
+        int yBegin = band * bandHeight;
+        int yEnd = std::min(height, yBegin + bandHeight);
+        if (yBegin < yEnd) {
+          //Dense column histograms up to the 257 bins of an 8-bit image
+          if (tableSize <= 257) {
+            claheExact(I1, I2, width, height, step, nbChannels, blockRadius, bins, &tableIndex[0], tableBegin,
+                       tableSize, slope, yBegin, yEnd);
+          } else {
+            claheExactCompact(I1, I2, width, height, step, nbChannels, blockRadius, bins, &tableIndex[0],
+                              tableBegin, tableSize, slope, yBegin, yEnd);
+          }
+        }
       }
     }
   }
 }
 
+/*!
+  \ingroup group_imgproc_brightness
+  
+   Adjust the contrast of a grayscale image locally using the Contrast Limited Adaptative Histogram Equalization method.
+   The limit parameter allows to limit the slope of the transformation function to prevent the overamplification of noise.
+   This method is a transcription of the CLAHE ImageJ plugin code by Stephan Saalfeld.
+
+   \param I1 : The first grayscale image.
+   \param I2 : The second grayscale image after application of the CLAHE method.
+   \param blockRadius : The size (2*blockRadius+1) of the local region around a pixel for which the histogram is equalized.
+   This size should be larger than the size of features to be preserved.
+   \param bins : The number of histogram bins used for histogram equalization (between 1 and 256).
+   The number of histogram bins should be smaller than the number of pixels in a block.
+   \param slope : Limits the contrast stretch in the intensity transfer function.
+   Very large values will let the histogram equalization do whatever it wants to do, that is result in maximal local contrast.
+   The value 1 will result in the original image.
+   \param fast : Use the fast but less accurate version of the filter. The fast version does not evaluate the intensity
+   transfer function for each pixel independently but for a grid of adjacent boxes of the given block size only
+   and interpolates for locations in between. The transfer functions of the grid are computed only once and,
+   when OpenMP is available, the computation and the interpolation are done in parallel.
+   \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+   is used. The exact version splits the image into horizontal bands processed independently.
+   The result does not depend on the number of threads.
+*/
+void vp::clahe(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const int blockRadius,
+               const int bins, const float slope, const bool fast, const int nbThreads) {
+  if (!checkParameters(blockRadius, bins, 256, I1.getWidth(), I1.getHeight())) {
+    return;
+  }
+
+  I2.resize(I1.getHeight(), I1.getWidth());
+  claheInterleaved(I1.bitmap, I2.bitmap, (int) I1.getWidth(), (int) I1.getHeight(), 1, 1, blockRadius, bins, slope,
+                   fast, nbThreads);
+}
+
+/*!
+  \ingroup group_imgproc_brightness
+
+  Adjust the contrast of a 16-bit grayscale image locally using the Contrast Limited Adaptative Histogram Equalization
+  method, see the 8-bit version for the description of the method.
+
+  \param I1 : The first 16-bit grayscale image.
+  \param I2 : The second 16-bit grayscale image after application of the CLAHE method.
+  \param blockRadius : The size (2*blockRadius+1) of the local region around a pixel for which the histogram is equalized.
+  \param bins : The number of histogram bins used for histogram equalization (between 1 and 4096). Each block
+  histogram is clipped over all the bins, the bins are limited to keep the clipping cost bounded with both versions.
+  The histograms are stored only for the range of bins used by the image, the exact version is faster with less bins.
+  \param slope : Limits the contrast stretch in the intensity transfer function.
+  \param fast : Use the fast but less accurate version of the filter.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The result does not depend on the number of threads.
+*/
+void vp::clahe(const vpImage<unsigned short> &I1, vpImage<unsigned short> &I2, const int blockRadius,
+               const int bins, const float slope, const bool fast, const int nbThreads) {
+  if (!checkParameters(blockRadius, bins, 4096, I1.getWidth(), I1.getHeight())) {
+    return;
+  }
+
+  I2.resize(I1.getHeight(), I1.getWidth());
+  claheInterleaved(I1.bitmap, I2.bitmap, (int) I1.getWidth(), (int) I1.getHeight(), 1, 1, blockRadius, bins, slope,
+                   fast, nbThreads);
+}
+
 /*!
   \ingroup group_imgproc_brightness
   
@@ -458,7 +973,7 @@ void vp::clahe(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, con
   This method is a transcription of the CLAHE ImageJ plugin code by Stephan Saalfeld.
 
   \param I1 : The first color image.
-  \param I2 : The second color image after application of the CLAHE method.
+  \param I2 : The second color image after application of the CLAHE method, can be I1 (the exact version copies I1).
   \param blockRadius : The size (2*blockRadius+1) of the local region around a pixel for which the histogram is equalized.
   This size should be larger than the size of features to be preserved.
   \param  bins : The number of histogram bins used for histogram equalization (between 1 and 256).
@@ -469,43 +984,187 @@ void vp::clahe(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, con
   \param fast : Use the fast but less accurate version of the filter. The fast version does not evaluate the intensity
   transfer function for each pixel independently but for a grid of adjacent boxes of the given block size only
   and interpolates for locations in between.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The result does not depend on the number of threads.
+  \param useHSV : If true, the CLAHE method is applied only on the value channel (in HSV space), which preserves the
+  hue and the saturation, otherwise the CLAHE method is applied independently on the RGB channels.
 */
 void vp::clahe(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const int blockRadius,
-               const int bins, const float slope, const bool fast) {
-  //Split
-  vpImage<unsigned char> pR(I1.getHeight(), I1.getWidth());
-  vpImage<unsigned char> pG(I1.getHeight(), I1.getWidth());
-  vpImage<unsigned char> pB(I1.getHeight(), I1.getWidth());
-  vpImage<unsigned char> pa(I1.getHeight(), I1.getWidth());
+               const int bins, const float slope, const bool fast, const int nbThreads, const bool useHSV) {
+  if (!checkParameters(blockRadius, bins, 256, I1.getWidth(), I1.getHeight())) {
+    return;
+  }
+
+  if (useHSV) {
+    //The value channel is max(R,G,B), with hue and saturation unchanged the conversion back to RGB
+    //amounts to scale the RGB channels by V'/V, the hue and saturation planes are never computed
+    unsigned int size = I1.getWidth()*I1.getHeight();
+    vpImage<unsigned char> value(I1.getHeight(), I1.getWidth());
+    vpImage<unsigned char> value_clahe(I1.getHeight(), I1.getWidth());
+
+    for (unsigned int i = 0; i < size; i++) {
+      const vpRGBa &rgba = I1.bitmap[i];
+      value.bitmap[i] = std::max(rgba.R, std::max(rgba.G, rgba.B));
+    }
+
+    claheInterleaved(value.bitmap, value_clahe.bitmap, (int) I1.getWidth(), (int) I1.getHeight(), 1, 1,
+                     blockRadius, bins, slope, fast, nbThreads);
+
+    //Each pixel is read before being written, in-place processing is possible
+    I2.resize(I1.getHeight(), I1.getWidth());
+    for (unsigned int i = 0; i < size; i++) {
+      const vpRGBa rgba = I1.bitmap[i];
+      int v = value.bitmap[i], v_clahe = value_clahe.bitmap[i];
+
+      if (v == 0) {
+        //Black pixel, null saturation
+        I2.bitmap[i] = vpRGBa((unsigned char) v_clahe, (unsigned char) v_clahe, (unsigned char) v_clahe, rgba.A);
+      } else {
+        I2.bitmap[i] = vpRGBa((unsigned char) ((rgba.R * v_clahe + v / 2) / v),
+                              (unsigned char) ((rgba.G * v_clahe + v / 2) / v),
+                              (unsigned char) ((rgba.B * v_clahe + v / 2) / v), rgba.A);
+      }
+    }
+
+    return;
+  }
+
+  if (!fast && &I1 == &I2) {
+    //The exact version slides the window over the input image while the output image is written, the fast version
+    //computes the transfer functions before writing and each output pixel depends only on the input pixel at the
+    //same location, it is done in place
+    vpImage<vpRGBa> I1_copy = I1;
+    vp::clahe(I1_copy, I2, blockRadius, bins, slope, fast, nbThreads, false);
+    return;
+  }
+
+  //Apply CLAHE independently on RGB channels, in a single pass over the interleaved image
+  I2.resize(I1.getHeight(), I1.getWidth());
+  claheInterleaved((const unsigned char *) I1.bitmap, (unsigned char *) I2.bitmap, (int) I1.getWidth(),
+                   (int) I1.getHeight(), 4, 3, blockRadius, bins, slope, fast, nbThreads);
+}
+
+/*!
+  Create a CLAHE context for images of size width x height, see vp::clahe() for the description of the parameters.
+
+  \param width : Width of the images.
+  \param height : Height of the images.
+  \param blockRadius : The size (2*blockRadius+1) of the local region around a pixel for which the histogram is equalized.
+  \param bins : The number of histogram bins used for histogram equalization (between 1 and 256).
+  \param slope : Limits the contrast stretch in the intensity transfer function.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used.
+*/
+vp::vpCLAHEContext::vpCLAHEContext(const unsigned int width, const unsigned int height, const int blockRadius,
+                                   const int bins, const float slope, const int nbThreads) :
+  m_width(width), m_height(height), m_blockRadius(blockRadius), m_bins(bins), m_slope(slope), m_nbThreads(1),
+  m_valid(false), m_temporalSmoothing(0.0f), m_previousNbChannels(0), m_binLut(), m_cs(), m_rs(), m_columnWeights(),
+  m_rowWeights(), m_histograms(), m_transfers(), m_previousTransfers() {
+  m_valid = checkParameters(blockRadius, bins, 256, width, height);
+  if (!m_valid) {
+    return;
+  }
 
-  vpImageConvert::split(I1, &pR, &pG, &pB, &pa);
+#if defined VISP_HAVE_OPENMP
+  m_nbThreads = nbThreads > 0 ? nbThreads : omp_get_max_threads();
+#else
+  (void) nbThreads;
+#endif
+
+  computeBlockCenters((int) width, blockRadius, m_cs);
+  computeBlockCenters((int) height, blockRadius, m_rs);
+  computeBinLut(bins, 255, m_binLut);
+  computeWeights((int) width, m_cs, m_columnWeights);
+  computeWeights((int) height, m_rs, m_rowWeights);
+
+  //Buffers sized for the color images (3 channels)
+  m_histograms.resize((size_t) (m_nbThreads * 4 * (bins+1)));
+  m_transfers.resize(m_rs.size() * m_cs.size() * (size_t) (3 * (bins+1)));
+  m_previousTransfers.resize(m_transfers.size());
+}
 
-  //Apply CLAHE independently on RGB channels
-  vpImage<unsigned char> resR, resG, resB;
-  clahe(pR, resR, blockRadius, bins, slope, fast);
-  clahe(pG, resG, blockRadius, bins, slope, fast);
-  clahe(pB, resB, blockRadius, bins, slope, fast);
+/*!
+  Apply the fast CLAHE method on a grayscale image.
+
+  \param I1 : The first grayscale image, with the size given at construction.
+  \param I2 : The second grayscale image after application of the CLAHE method, can be I1 (no copy is done).
+*/
+void vp::vpCLAHEContext::apply(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2) {
+  if (!checkImageSize(I1.getWidth(), I1.getHeight())) {
+    return;
+  }
 
+  //In place is supported without copy: the transfer functions are computed before writing I2, and each pixel of I2
+  //depends only on the pixel of I1 at the same location
   I2.resize(I1.getHeight(), I1.getWidth());
-  unsigned int size = I2.getWidth()*I2.getHeight();
-  unsigned char *ptrStart = (unsigned char *) I2.bitmap;
-  unsigned char *ptrEnd = ptrStart + size*4;
-  unsigned char *ptrCurrent = ptrStart;
+  apply(I1.bitmap, I2.bitmap, I1.getWidth(), I1.getHeight(), 1, 1);
+}
 
-  unsigned int cpt = 0;
-  while (ptrCurrent != ptrEnd) {
-    *ptrCurrent = resR.bitmap[cpt];
-    ++ptrCurrent;
+/*!
+  Apply the fast CLAHE method independently on the RGB channels of a color image.
 
-    *ptrCurrent = resG.bitmap[cpt];
-    ++ptrCurrent;
+  \param I1 : The first color image, with the size given at construction.
+  \param I2 : The second color image after application of the CLAHE method, can be I1 (no copy is done).
+*/
+void vp::vpCLAHEContext::apply(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2) {
+  if (!checkImageSize(I1.getWidth(), I1.getHeight())) {
+    return;
+  }
 
-    *ptrCurrent = resB.bitmap[cpt];
-    ++ptrCurrent;
+  //In place is supported without copy: the transfer functions are computed before writing I2, and each pixel of I2
+  //depends only on the pixel of I1 at the same location
+  I2.resize(I1.getHeight(), I1.getWidth());
+  apply((const unsigned char *) I1.bitmap, (unsigned char *) I2.bitmap, I1.getWidth(), I1.getHeight(), 4, 3);
+}
 
-    *ptrCurrent = pa.bitmap[cpt];
-    ++ptrCurrent;
+void vp::vpCLAHEContext::apply(const unsigned char *I1, unsigned char *I2, const unsigned int width,
+                               const unsigned int height, const int step, const int nbChannels) {
+  //The transfer functions are kept for all the bins, to be comparable between two images
+  computeTransfers(I1, (int) width, (int) height, step, nbChannels, m_blockRadius, m_bins, &m_binLut[0], 0,
+                   m_bins+1, m_slope, m_cs, m_rs, m_histograms, m_transfers, m_nbThreads);
 
-    cpt++;
+  if (m_temporalSmoothing > 0.0f && m_previousNbChannels == nbChannels) {
+    size_t size = m_rs.size() * m_cs.size() * (size_t) (nbChannels * (m_bins+1));
+    for (size_t i = 0; i < size; i++) {
+      m_transfers[i] = m_temporalSmoothing * m_previousTransfers[i] + (1.0f - m_temporalSmoothing) * m_transfers[i];
+    }
   }
+
+  interpolateTransfers(I1, I2, (int) width, (int) height, step, nbChannels, &m_binLut[0], m_bins+1, m_cs, m_rs,
+                       m_columnWeights, m_rowWeights, m_transfers, m_nbThreads);
+
+  //Keep the transfer functions for the next image, without copy
+  m_transfers.swap(m_previousTransfers);
+  m_previousNbChannels = nbChannels;
+}
+
+bool vp::vpCLAHEContext::checkImageSize(const unsigned int width, const unsigned int height) const {
+  if (!m_valid) {
+    std::cerr << "Error: invalid CLAHE context parameters!" << std::endl;
+    return false;
+  }
+
+  if (width != m_width || height != m_height) {
+    std::cerr << "Error: the image size does not match the CLAHE context size!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+  Forget the transfer functions of the previous image, the next image is processed without temporal smoothing.
+*/
+void vp::vpCLAHEContext::reset() {
+  m_previousNbChannels = 0;
+}
+
+/*!
+  Set the weight of the transfer functions of the previous image. The transfer functions used for the current image
+  are: smoothing * previous + (1 - smoothing) * current. A value of 0 (default) disables the temporal smoothing.
+
+  \param smoothing : Weight in [0, 1[, clamped to [0, 0.99].
+*/
+void vp::vpCLAHEContext::setTemporalSmoothing(const float smoothing) {
+  m_temporalSmoothing = std::max(0.0f, std::min(smoothing, 0.99f));
 }
@@ -40,129 +40,623 @@
   \brief Basic connected components.
 */
 
-#include <queue>
+#include <algorithm>
+#include <limits>
+
 #include <visp3/imgproc/vpImgproc.h>
 
+#if defined VISP_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 namespace {
-void getNeighbors(const vpImage<unsigned char> &I, std::queue<vpImagePoint> &listOfNeighbors,
-                  const unsigned int i, const unsigned int j,
-                  const vpImageMorphology::vpConnexityType &connexity) {
-  unsigned char currValue = I[i][j];
-
-  if (connexity == vpImageMorphology::CONNEXITY_4) {
-    //Top
-    if (I[i-1][j] == currValue) {
-      listOfNeighbors.push(vpImagePoint(i-1, j));
-    }
+//Union-find on the provisional labels with path compression, the root of a set being its smallest label.
+//See: Wu K., Otoo E. and Suzuki K. (2009), "Optimizing two-pass connected-component labeling algorithms",
+//Pattern Analysis and Applications 12: 117-135.
+inline int findRoot(const std::vector<int> &parent, int i) {
+  while (parent[(size_t) i] < i) {
+    i = parent[(size_t) i];
+  }
+
+  return i;
+}
 
-    //Left
-    if (I[i][j-1] == currValue) {
-      listOfNeighbors.push(vpImagePoint(i, j-1));
+inline void setRoot(std::vector<int> &parent, int i, const int root) {
+  while (parent[(size_t) i] < i) {
+    int j = parent[(size_t) i];
+    parent[(size_t) i] = root;
+    i = j;
+  }
+
+  parent[(size_t) i] = root;
+}
+
+inline int merge(std::vector<int> &parent, const int i, const int j) {
+  int root = findRoot(parent, i);
+  if (i != j) {
+    int rootj = findRoot(parent, j);
+    if (root > rootj) {
+      root = rootj;
     }
+    setRoot(parent, j, root);
+  }
+  setRoot(parent, i, root);
 
-    //Right
-    if (I[i][j+1] == currValue) {
-      listOfNeighbors.push(vpImagePoint(i, j+1));
+  return root;
+}
+
+inline int newLabel(std::vector<int> &parent) {
+  int label = (int) parent.size();
+  parent.push_back(label);
+
+  return label;
+}
+
+//Statistics of the components are accumulated per run of consecutive pixels with the same label
+void resizeStatistics(vp::vpConnectedComponentsStats &stats, const size_t size, const bool moments) {
+  stats.m_area.resize(size, 0);
+  stats.m_top.resize(size, std::numeric_limits<unsigned int>::max());
+  stats.m_left.resize(size, std::numeric_limits<unsigned int>::max());
+  stats.m_bottom.resize(size, 0);
+  stats.m_right.resize(size, 0);
+  stats.m_sumI.resize(size, 0.0);
+  stats.m_sumJ.resize(size, 0.0);
+
+  if (moments) {
+    stats.m_sumII.resize(size, 0.0);
+    stats.m_sumIJ.resize(size, 0.0);
+    stats.m_sumJJ.resize(size, 0.0);
+  }
+}
+
+inline double sumOfSquares(const double n) {
+  return n * (n + 1.0) * (2.0*n + 1.0) / 6.0;
+}
+
+//Add the pixels (i, jBegin) to (i, jEnd) to the element k
+inline void addRun(vp::vpConnectedComponentsStats &stats, const size_t k, const unsigned int i,
+                   const unsigned int jBegin, const unsigned int jEnd, const bool moments) {
+  unsigned int length = jEnd - jBegin + 1;
+  double sumJ = length * (jBegin + jEnd) / 2.0;
+
+  stats.m_area[k] += length;
+  stats.m_top[k] = std::min(stats.m_top[k], i);
+  stats.m_left[k] = std::min(stats.m_left[k], jBegin);
+  stats.m_bottom[k] = std::max(stats.m_bottom[k], i);
+  stats.m_right[k] = std::max(stats.m_right[k], jEnd);
+  stats.m_sumI[k] += length * (double) i;
+  stats.m_sumJ[k] += sumJ;
+
+  if (moments) {
+    stats.m_sumII[k] += length * (double) i * (double) i;
+    stats.m_sumIJ[k] += (double) i * sumJ;
+    stats.m_sumJJ[k] += sumOfSquares(jEnd) - (jBegin > 0 ? sumOfSquares(jBegin - 1) : 0.0);
+  }
+}
+
+//Add the element l of src to the element k of dst
+inline void mergeStatistics(vp::vpConnectedComponentsStats &dst, const size_t k,
+                            const vp::vpConnectedComponentsStats &src, const size_t l, const bool moments) {
+  dst.m_area[k] += src.m_area[l];
+  dst.m_top[k] = std::min(dst.m_top[k], src.m_top[l]);
+  dst.m_left[k] = std::min(dst.m_left[k], src.m_left[l]);
+  dst.m_bottom[k] = std::max(dst.m_bottom[k], src.m_bottom[l]);
+  dst.m_right[k] = std::max(dst.m_right[k], src.m_right[l]);
+  dst.m_sumI[k] += src.m_sumI[l];
+  dst.m_sumJ[k] += src.m_sumJ[l];
+
+  if (moments) {
+    dst.m_sumII[k] += src.m_sumII[l];
+    dst.m_sumIJ[k] += src.m_sumIJ[l];
+    dst.m_sumJJ[k] += src.m_sumJJ[l];
+  }
+}
+
+//Nothing is accumulated for the plain labeling
+class vpNoStatistics {
+public:
+  void addRow(const int *, const int, const unsigned int, const size_t) {
+  }
+};
+
+//Statistics indexed by the provisional labels of a strip, updated after each scanned row while it is in cache
+class vpRunStatistics {
+public:
+  explicit vpRunStatistics(const bool moments) : m_stats(), m_moments(moments) {
+  }
+
+  void addRow(const int *labelRow, const int width, const unsigned int i, const size_t nbLabels) {
+    if (m_stats.m_area.size() < nbLabels) {
+      resizeStatistics(m_stats, nbLabels, m_moments);
     }
 
-    //Bottom
-    if (I[i+1][j] == currValue) {
-      listOfNeighbors.push(vpImagePoint(i+1, j));
+    for (int j = 0; j < width;) {
+      int label = labelRow[j];
+      int jBegin = j;
+      while (j < width && labelRow[j] == label) {
+        j++;
+      }
+
+      if (label) {
+        addRun(m_stats, (size_t) label, i, (unsigned int) jBegin, (unsigned int) j - 1, m_moments);
+      }
     }
-  } else {
-    for (int cpt1 = -1; cpt1 <= 1; cpt1++) {
-      for (int cpt2 = -1; cpt2 <= 1; cpt2++) {
-        //Everything except the current position
-        if (cpt1 != 0 || cpt2 != 0) {
-          if ( I[(int) i + cpt1][(int) j + cpt2] == currValue ) {
-            listOfNeighbors.push(vpImagePoint( (int) i + cpt1, (int) j + cpt2));
+  }
+
+  vp::vpConnectedComponentsStats m_stats;
+  bool m_moments;
+};
+
+//Binary labeling: the neighbors with the same non zero value are connected, 0 is the background
+class vpSameNonZeroValue {
+public:
+  static const bool transitive = true;
+
+  inline bool isBackground(const unsigned char value) const {
+    return value == 0;
+  }
+
+  inline bool connected(const unsigned char value1, const unsigned char value2) const {
+    return value1 == value2;
+  }
+};
+
+//Multi-valued labeling: the neighbors with the same value are connected, including 0
+class vpSameValue {
+public:
+  static const bool transitive = true;
+
+  inline bool isBackground(const unsigned char) const {
+    return false;
+  }
+
+  inline bool connected(const unsigned char value1, const unsigned char value2) const {
+    return value1 == value2;
+  }
+};
+
+//Multi-valued labeling with a tolerance: the neighbors whose values differ by at most the tolerance are connected.
+//This relation is not transitive, two neighbors connected to the current pixel are not necessarily connected together.
+class vpCloseValue {
+public:
+  static const bool transitive = false;
+
+  explicit vpCloseValue(const unsigned char tolerance) : m_tolerance(tolerance) {
+  }
+
+  inline bool isBackground(const unsigned char) const {
+    return false;
+  }
+
+  inline bool connected(const unsigned char value1, const unsigned char value2) const {
+    return (value1 > value2 ? value1 - value2 : value2 - value1) <= m_tolerance;
+  }
+
+private:
+  int m_tolerance;
+};
+
+inline int join(std::vector<int> &parent, const int label, const int neighborLabel) {
+  return label ? merge(parent, label, neighborLabel) : neighborLabel;
+}
+
+//First pass: provisional labels for the rows [rowBegin, rowEnd[, the row rowBegin being scanned as the first row
+//of the image.
+template <class Statistics, class Connection>
+void scanRows(const vpImage<unsigned char> &I, vpImage<int> &labels, std::vector<int> &parent,
+              const unsigned int rowBegin, const unsigned int rowEnd,
+              const vpImageMorphology::vpConnexityType &connexity, Statistics &statistics,
+              const Connection &connection) {
+  int width = (int) I.getWidth();
+
+  for (unsigned int i = rowBegin; i < rowEnd; i++) {
+    const unsigned char *row = I[i];
+    const unsigned char *prevRow = i > rowBegin ? I[i-1] : NULL;
+    int *labelRow = labels[i];
+    const int *prevLabelRow = i > rowBegin ? labels[i-1] : NULL;
+
+    for (int j = 0; j < width; j++) {
+      unsigned char value = row[j];
+      if (connection.isBackground(value)) {
+        labelRow[j] = 0;
+      } else if (!Connection::transitive) {
+        //All the connected neighbors must be merged
+        int label = 0;
+        if (prevRow != NULL) {
+          if (connexity == vpImageMorphology::CONNEXITY_8 && j > 0 && connection.connected(prevRow[j-1], value)) {
+            label = prevLabelRow[j-1];
+          }
+          if (connection.connected(prevRow[j], value)) {
+            label = join(parent, label, prevLabelRow[j]);
+          }
+          if (connexity == vpImageMorphology::CONNEXITY_8 && j+1 < width &&
+              connection.connected(prevRow[j+1], value)) {
+            label = join(parent, label, prevLabelRow[j+1]);
+          }
+        }
+        if (j > 0 && connection.connected(row[j-1], value)) {
+          label = join(parent, label, labelRow[j-1]);
+        }
+
+        labelRow[j] = label ? label : newLabel(parent);
+      } else {
+        //Neighbors already scanned: a (top left), b (top), c (top right) and d (left)
+        bool b = prevRow != NULL && connection.connected(prevRow[j], value);
+        bool d = j > 0 && connection.connected(row[j-1], value);
+
+        if (connexity == vpImageMorphology::CONNEXITY_4) {
+          if (b) {
+            labelRow[j] = d ? merge(parent, prevLabelRow[j], labelRow[j-1]) : prevLabelRow[j];
+          } else {
+            labelRow[j] = d ? labelRow[j-1] : newLabel(parent);
+          }
+        } else if (b) {
+          //a, c and d are neighbors of b
+          labelRow[j] = prevLabelRow[j];
+        } else {
+          bool a = prevRow != NULL && j > 0 && connection.connected(prevRow[j-1], value);
+          bool c = prevRow != NULL && j+1 < width && connection.connected(prevRow[j+1], value);
+
+          if (c) {
+            if (a) {
+              labelRow[j] = merge(parent, prevLabelRow[j+1], prevLabelRow[j-1]);
+            } else if (d) {
+              labelRow[j] = merge(parent, prevLabelRow[j+1], labelRow[j-1]);
+            } else {
+              labelRow[j] = prevLabelRow[j+1];
+            }
+          } else if (a) {
+            labelRow[j] = prevLabelRow[j-1];
+          } else if (d) {
+            labelRow[j] = labelRow[j-1];
+          } else {
+            labelRow[j] = newLabel(parent);
           }
         }
       }
     }
+
+    statistics.addRow(labelRow, width, i, parent.size());
   }
 }
 
-void visitNeighbors(vpImage<unsigned char> &I_copy, std::queue<vpImagePoint> &listOfNeighbors, vpImage<int> &labels,
-                    const int current_label, const vpImageMorphology::vpConnexityType &connexity) {
-  //Visit the neighbors
-  while (!listOfNeighbors.empty()) {
-    vpImagePoint imPt = listOfNeighbors.front();
-    unsigned int i = (unsigned int) imPt.get_i();
-    unsigned int j = (unsigned int) imPt.get_j();
-    listOfNeighbors.pop();
+//Merge the equivalences across the boundary between the strip ending at row-1 and the strip starting at row, whose
+//provisional labels are shifted by offsetTop and offsetBottom in the global union-find array.
+template <class Connection>
+void mergeStrips(const vpImage<unsigned char> &I, const vpImage<int> &labels, std::vector<int> &parent,
+                 const unsigned int row, const int offsetTop, const int offsetBottom,
+                 const vpImageMorphology::vpConnexityType &connexity, const Connection &connection) {
+  int width = (int) I.getWidth();
+  const unsigned char *row_ = I[row];
+  const unsigned char *prevRow = I[row-1];
+  const int *labelRow = labels[row];
+  const int *prevLabelRow = labels[row-1];
 
-    if (I_copy[i][j]) {
-      getNeighbors(I_copy, listOfNeighbors, i, j, connexity);
+  for (int j = 0; j < width; j++) {
+    unsigned char value = row_[j];
+    if (!connection.isBackground(value)) {
+      int label = labelRow[j] + offsetBottom;
+      bool b = connection.connected(prevRow[j], value);
 
-      //Reset current position and set label
-      I_copy[i][j] = 0;
-      labels[i][j] = current_label;
+      if (b) {
+        merge(parent, label, prevLabelRow[j] + offsetTop);
+      }
+
+      //When the relation is transitive and the top neighbor is connected, the top left and top right neighbors
+      //connected to the current pixel are in the set of the top neighbor
+      if (connexity == vpImageMorphology::CONNEXITY_8 && (!b || !Connection::transitive)) {
+        if (j > 0 && connection.connected(prevRow[j-1], value)) {
+          merge(parent, label, prevLabelRow[j-1] + offsetTop);
+        }
+        if (j+1 < width && connection.connected(prevRow[j+1], value)) {
+          merge(parent, label, prevLabelRow[j+1] + offsetTop);
+        }
+      }
     }
   }
 }
+
+//Replace each provisional label by a consecutive final label. The sets are numbered in the order of their smallest
+//provisional label, that is in the raster order of the first pixel of each component.
+int flattenLabels(std::vector<int> &parent) {
+  int nbLabels = 0;
+  for (size_t i = 1; i < parent.size(); i++) {
+    if (parent[i] < (int) i) {
+      parent[i] = parent[(size_t) parent[i]];
+    } else {
+      parent[i] = ++nbLabels;
+    }
+  }
+
+  return nbLabels;
+}
+
+//Label the image by horizontal strips, one per thread, and merge the equivalences across the strip boundaries.
+//On return, parent[offsets[strip] + label] is the final label of the provisional label of a strip, and
+//statistics[strip] holds the statistics of the provisional labels of the strip.
+template <class Statistics, class Connection>
+int labelStrips(const vpImage<unsigned char> &I, vpImage<int> &labels,
+                const vpImageMorphology::vpConnexityType &connexity, const Connection &connection,
+                const int nbThreads, const Statistics &prototype, std::vector<Statistics> &statistics,
+                std::vector<int> &parent, std::vector<unsigned int> &stripRows, std::vector<int> &offsets) {
+  labels.resize(I.getHeight(), I.getWidth());
+
+  int height = (int) I.getHeight();
+  int nbStrips = std::max(1, std::min(nbThreads, height));
+  std::vector<std::vector<int> > stripParents((size_t) nbStrips, std::vector<int>(1, 0));
+  statistics.assign((size_t) nbStrips, prototype);
+  stripRows.resize((size_t) nbStrips + 1);
+  for (int strip = 0; strip <= nbStrips; strip++) {
+    stripRows[(size_t) strip] = (unsigned int) (((long) strip * height) / nbStrips);
+  }
+
+  //First pass on each strip, with provisional labels local to the strip
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbThreads)
+#endif
+  for (int strip = 0; strip < nbStrips; strip++) {
+    scanRows(I, labels, stripParents[(size_t) strip], stripRows[(size_t) strip], stripRows[(size_t) strip + 1],
+             connexity, statistics[(size_t) strip], connection);
+  }
+
+  //Global union-find array: the provisional labels of a strip follow those of the previous strips, so that they
+  //remain in raster order
+  offsets.assign((size_t) nbStrips, 0);
+  parent.clear();
+  if (nbStrips == 1) {
+    parent.swap(stripParents[0]);
+  } else {
+    size_t nbLabels = 1;
+    for (int strip = 0; strip < nbStrips; strip++) {
+      offsets[(size_t) strip] = (int) nbLabels - 1;
+      nbLabels += stripParents[(size_t) strip].size() - 1;
+    }
+
+    parent.resize(nbLabels);
+    parent[0] = 0;
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbThreads)
+#endif
+    for (int strip = 0; strip < nbStrips; strip++) {
+      const std::vector<int> &stripParent = stripParents[(size_t) strip];
+      int offset = offsets[(size_t) strip];
+      for (size_t i = 1; i < stripParent.size(); i++) {
+        parent[i + (size_t) offset] = stripParent[i] + offset;
+      }
+    }
+
+    for (int strip = 1; strip < nbStrips; strip++) {
+      mergeStrips(I, labels, parent, stripRows[(size_t) strip], offsets[(size_t) strip - 1], offsets[(size_t) strip],
+                  connexity, connection);
+    }
+  }
+
+  return flattenLabels(parent);
+}
+
+//Second pass: replace the provisional labels by the final labels
+void relabelStrips(vpImage<int> &labels, const std::vector<int> &parent, const std::vector<unsigned int> &stripRows,
+                   const std::vector<int> &offsets, const int nbThreads) {
+  int nbStrips = (int) offsets.size();
+
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbThreads)
+#else
+  (void) nbThreads;
+#endif
+  for (int strip = 0; strip < nbStrips; strip++) {
+    int offset = offsets[(size_t) strip];
+    int *ptrLabels = labels[stripRows[(size_t) strip]];
+    int *ptrLabelsEnd = labels.bitmap + (size_t) stripRows[(size_t) strip + 1] * labels.getWidth();
+    for (; ptrLabels != ptrLabelsEnd; ++ptrLabels) {
+      if (*ptrLabels) {
+        *ptrLabels = parent[(size_t) (*ptrLabels + offset)];
+      }
+    }
+  }
+}
+
+int getNbThreads(const int nbThreads) {
+#if defined VISP_HAVE_OPENMP
+  return nbThreads > 0 ? nbThreads : omp_get_max_threads();
+#else
+  (void) nbThreads;
+  return 1;
+#endif
+}
 } //namespace
 
 /*!
   \ingroup group_imgproc_connected_components
 
-  Perform connected components detection.
+  Perform connected components detection. Two-pass labeling with union-find: the components are labeled from 1 to
+  \e nbComponents in the raster order of their first pixel.
 
   \param I : Input image (0 means background).
   \param labels : Label image that contain for each position the component label.
   \param nbComponents : Number of connected components.
   \param connexity : Type of connexity.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The image is split into horizontal strips labeled concurrently, the equivalences across the strip
+  boundaries are then merged and the final relabeling is done in parallel. The result does not depend on the number
+  of threads.
 */
 void vp::connectedComponents(const vpImage<unsigned char> &I, vpImage<int> &labels, int &nbComponents,
-                             const vpImageMorphology::vpConnexityType &connexity) {
+                             const vpImageMorphology::vpConnexityType &connexity, const int nbThreads) {
   if (I.getSize() == 0) {
     return;
   }
 
-  labels.resize(I.getHeight(), I.getWidth());
+  int nbThreads_ = getNbThreads(nbThreads);
+  std::vector<vpNoStatistics> statistics;
+  std::vector<int> parent, offsets;
+  std::vector<unsigned int> stripRows;
+  nbComponents = labelStrips(I, labels, connexity, vpSameNonZeroValue(), nbThreads_, vpNoStatistics(), statistics,
+                             parent, stripRows, offsets);
+  relabelStrips(labels, parent, stripRows, offsets, nbThreads_);
+}
 
-  vpImage<unsigned char> I_copy(I.getHeight()+2, I.getWidth()+2);
-  // Copy and add border
-  for (unsigned int i = 0; i < I_copy.getHeight(); i++) {
-    if (i == 0 || i == I_copy.getHeight() - 1) {
-      memset(I_copy[i], 0, sizeof(unsigned char)*I_copy.getWidth());
-    } else {
-      I_copy[i][0] = 0;
-      memcpy(I_copy[i]+1, I[i-1], sizeof(unsigned char)*I.getWidth());
-      I_copy[i][I_copy.getWidth() - 1] = 0;
-    }
+/*!
+  \ingroup group_imgproc_connected_components
+
+  Perform connected components detection on a multi-valued image: all the pixels are labeled, including the pixels
+  with the value 0, and two neighbors belong to the same component when their values differ by at most \e tolerance.
+  With a tolerance, the values inside a component can vary by more than the tolerance through a chain of neighbors.
+  The components are labeled from 1 to \e nbComponents in the raster order of their first pixel.
+
+  \param I : Input image.
+  \param labels : Label image that contain for each position the component label.
+  \param nbComponents : Number of connected components.
+  \param tolerance : Maximal difference between the values of two connected neighbors, 0 to label the connected
+  regions of equal value.
+  \param connexity : Type of connexity.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The result does not depend on the number of threads.
+*/
+void vp::connectedComponentsMultiValued(const vpImage<unsigned char> &I, vpImage<int> &labels, int &nbComponents,
+                                        const unsigned char tolerance,
+                                        const vpImageMorphology::vpConnexityType &connexity, const int nbThreads) {
+  if (I.getSize() == 0) {
+    return;
   }
 
-  vpImage<int> labels_copy(I.getHeight()+2, I.getWidth()+2, 0);
+  int nbThreads_ = getNbThreads(nbThreads);
+  std::vector<vpNoStatistics> statistics;
+  std::vector<int> parent, offsets;
+  std::vector<unsigned int> stripRows;
+  if (tolerance == 0) {
+    nbComponents = labelStrips(I, labels, connexity, vpSameValue(), nbThreads_, vpNoStatistics(), statistics,
+                               parent, stripRows, offsets);
+  } else {
+    nbComponents = labelStrips(I, labels, connexity, vpCloseValue(tolerance), nbThreads_, vpNoStatistics(),
+                               statistics, parent, stripRows, offsets);
+  }
+  relabelStrips(labels, parent, stripRows, offsets, nbThreads_);
+}
 
-  int current_label = 1;
-  std::queue<vpImagePoint> listOfNeighbors;
+/*!
+  \ingroup group_imgproc_connected_components
 
-  for (unsigned int cpt1 = 0; cpt1 < I.getHeight(); cpt1++) {
-    unsigned int i = cpt1+1;
+  Perform connected components detection and compute the statistics of each component during the labeling:
+  area, bounding box, sums of the coordinates and optionally the sums of the second order products of the
+  coordinates. The element k of the \e stats arrays corresponds to the label k+1.
 
-    for (unsigned int cpt2 = 0; cpt2 < I.getWidth(); cpt2++) {
-      unsigned int j = cpt2+1;
+  \param I : Input image (0 means background).
+  \param labels : Label image that contain for each position the component label.
+  \param nbComponents : Number of connected components.
+  \param stats : Statistics of the components, for instance the centroid of the label k+1 is
+  (stats.m_sumI[k] / stats.m_area[k], stats.m_sumJ[k] / stats.m_area[k]).
+  \param connexity : Type of connexity.
+  \param computeMoments : If true, also compute stats.m_sumII, stats.m_sumIJ and stats.m_sumJJ.
+  \param minArea : The components with less than \e minArea pixels are discarded: they are set to 0 in \e labels,
+  are not counted and have no statistics. The remaining components are labeled from 1 to \e nbComponents in the
+  raster order of their first pixel.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The result does not depend on the number of threads.
+*/
+void vp::connectedComponentsWithStats(const vpImage<unsigned char> &I, vpImage<int> &labels, int &nbComponents,
+                                      vpConnectedComponentsStats &stats,
+                                      const vpImageMorphology::vpConnexityType &connexity, const bool computeMoments,
+                                      const unsigned int minArea, const int nbThreads) {
+  if (I.getSize() == 0) {
+    return;
+  }
 
-      if (I_copy[i][j] && labels_copy[i][j] == 0) {
-        //Get all the neighbors relative to the current position
-        getNeighbors(I_copy, listOfNeighbors, i, j, connexity);
+  int nbThreads_ = getNbThreads(nbThreads);
+  std::vector<vpRunStatistics> statistics;
+  std::vector<int> parent, offsets;
+  std::vector<unsigned int> stripRows;
+  int nbLabels = labelStrips(I, labels, connexity, vpSameNonZeroValue(), nbThreads_, vpRunStatistics(computeMoments),
+                             statistics, parent, stripRows, offsets);
 
-        //Reset current position and set label
-        I_copy[i][j] = 0;
-        labels_copy[i][j] = current_label;
+  //Gather the statistics of the provisional labels
+  stats = vpConnectedComponentsStats();
+  resizeStatistics(stats, (size_t) nbLabels, computeMoments);
+  for (size_t strip = 0; strip < statistics.size(); strip++) {
+    const vpConnectedComponentsStats &stripStats = statistics[strip].m_stats;
+    for (size_t label = 1; label < stripStats.m_area.size(); label++) {
+      mergeStatistics(stats, (size_t) parent[label + (size_t) offsets[strip]] - 1, stripStats, label, computeMoments);
+    }
+  }
 
-        visitNeighbors(I_copy, listOfNeighbors, labels_copy, current_label, connexity);
+  //Discard the small components and renumber the remaining ones
+  std::vector<int> finalLabels((size_t) nbLabels + 1, 0);
+  nbComponents = 0;
+  for (size_t k = 0; k < (size_t) nbLabels; k++) {
+    if (stats.m_area[k] >= minArea) {
+      if ((size_t) nbComponents != k) {
+        stats.m_area[(size_t) nbComponents] = stats.m_area[k];
+        stats.m_top[(size_t) nbComponents] = stats.m_top[k];
+        stats.m_left[(size_t) nbComponents] = stats.m_left[k];
+        stats.m_bottom[(size_t) nbComponents] = stats.m_bottom[k];
+        stats.m_right[(size_t) nbComponents] = stats.m_right[k];
+        stats.m_sumI[(size_t) nbComponents] = stats.m_sumI[k];
+        stats.m_sumJ[(size_t) nbComponents] = stats.m_sumJ[k];
 
-        //Increment label
-        current_label++;
+        if (computeMoments) {
+          stats.m_sumII[(size_t) nbComponents] = stats.m_sumII[k];
+          stats.m_sumIJ[(size_t) nbComponents] = stats.m_sumIJ[k];
+          stats.m_sumJJ[(size_t) nbComponents] = stats.m_sumJJ[k];
+        }
       }
+
+      finalLabels[k + 1] = ++nbComponents;
+    }
+  }
+
+  if (nbComponents != nbLabels) {
+    resizeStatistics(stats, (size_t) nbComponents, computeMoments);
+    for (size_t i = 1; i < parent.size(); i++) {
+      parent[i] = finalLabels[(size_t) parent[i]];
     }
   }
 
-  for (unsigned int i = 0; i < labels.getHeight(); i++) {
-    memcpy(labels[i], labels_copy[i+1]+1, sizeof(int)*labels.getWidth());
+  relabelStrips(labels, parent, stripRows, offsets, nbThreads_);
+}
+
+/*!
+  \ingroup group_imgproc_connected_components
+
+  Perform connected components detection on a run-length encoded binary image, working on the runs instead of the
+  pixels. The labels are the same as the labels of the pixels of the decoded binary image.
+
+  \param I : Input binary image.
+  \param labels : Label of each run of I.getRuns(), from 1 to \e nbComponents in the raster order of the first pixel of
+  each component.
+  \param nbComponents : Number of connected components.
+  \param connexity : Type of connexity.
+*/
+void vp::connectedComponents(const vpRunLengthImage &I, std::vector<int> &labels, int &nbComponents,
+                             const vpImageMorphology::vpConnexityType &connexity) {
+  const std::vector<vpRun> &runs = I.getRuns();
+
+  //The provisional label of the run k is k+1, the runs being in raster order
+  std::vector<int> parent(runs.size() + 1);
+  for (size_t k = 0; k < parent.size(); k++) {
+    parent[k] = (int) k;
+  }
+
+  //With 8-connexity, runs of consecutive rows touching by a corner are connected
+  unsigned int tolerance = connexity == vpImageMorphology::CONNEXITY_8 ? 1 : 0;
+  for (unsigned int i = 1; i < I.getHeight(); i++) {
+    size_t prev, prevEnd, curr, currEnd;
+    I.getRowRuns(i - 1, prev, prevEnd);
+    I.getRowRuns(i, curr, currEnd);
+
+    while (prev < prevEnd && curr < currEnd) {
+      if (runs[prev].m_begin < runs[curr].m_end + tolerance && runs[curr].m_begin < runs[prev].m_end + tolerance) {
+        merge(parent, (int) curr + 1, (int) prev + 1);
+      }
+
+      //The run that ends first cannot touch the next runs of the other row
+      if (runs[prev].m_end < runs[curr].m_end) {
+        prev++;
+      } else {
+        curr++;
+      }
+    }
   }
 
-  nbComponents = current_label - 1;
+  nbComponents = flattenLabels(parent);
+  labels.assign(parent.begin() + 1, parent.end());
 }
@@ -40,14 +40,302 @@
   \brief Flood fill algorithm.
 */
 
-#include <queue>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
 #include <visp3/imgproc/vpImgproc.h>
 
+namespace {
+//Run [m_left, m_right] filled in the row m_row, the row m_row + m_direction remaining to be scanned
+struct vpFloodFillSpan {
+  int m_row;
+  int m_left;
+  int m_right;
+  int m_direction;
+
+  vpFloodFillSpan(const int row, const int left, const int right, const int direction) :
+    m_row(row), m_left(left), m_right(right), m_direction(direction) {
+  }
+};
+
+//Fill the run of pixels inside the region containing the pixel (i, j), which must be inside the region, and push
+//the spans to scan the rows above and below
+template <class Region>
+void fillSeedRun(Region &region, const int i, const int j, const int width, std::vector<vpFloodFillSpan> &spans) {
+  region.setRow(i);
+  int left = j, right = j;
+  while (left > 0 && region.inside(left-1)) {
+    left--;
+  }
+  while (right+1 < width && region.inside(right+1)) {
+    right++;
+  }
+  region.fill(left, right);
+
+  spans.push_back(vpFloodFillSpan(i, left, right, -1));
+  spans.push_back(vpFloodFillSpan(i, left, right, 1));
+}
+
+//Scanline filling: each horizontal run of pixels inside the region is filled at once, and only the ranges of the
+//rows above and below touching the run (extended by one pixel on each side with 8-connexity) are scanned for new
+//runs, until the stack of spans is empty. Region::fill() must leave the filled pixels outside of the region.
+template <class Region>
+void scanlineFill(Region &region, const int width, const int height,
+                  const vpImageMorphology::vpConnexityType &connexity, std::vector<vpFloodFillSpan> &spans) {
+  //Extension of the scanned ranges on the neighbor rows
+  int extension = connexity == vpImageMorphology::CONNEXITY_8 ? 1 : 0;
+
+  while (!spans.empty()) {
+    vpFloodFillSpan span = spans.back();
+    spans.pop_back();
+
+    int i = span.m_row + span.m_direction;
+    if (i < 0 || i >= height) {
+      continue;
+    }
+
+    region.setRow(i);
+    int j = std::max(0, span.m_left - extension);
+    int jEnd = std::min(width-1, span.m_right + extension);
+
+    while (j <= jEnd) {
+      if (!region.inside(j)) {
+        j++;
+      } else {
+        //New run, which can extend beyond the scanned range
+        int left = j, right = j;
+        while (left > 0 && region.inside(left-1)) {
+          left--;
+        }
+        while (right+1 < width && region.inside(right+1)) {
+          right++;
+        }
+        region.fill(left, right);
+
+        spans.push_back(vpFloodFillSpan(i, left, right, span.m_direction));
+        //The run goes beyond the parent run, the row of the parent run must also be scanned
+        if (left - extension < span.m_left || right + extension > span.m_right) {
+          spans.push_back(vpFloodFillSpan(i, left, right, -span.m_direction));
+        }
+
+        //The pixel right+1 is outside of the region
+        j = right + 2;
+      }
+    }
+  }
+}
+
+//Scanline filling from a seed inside the region
+template <class Region>
+void scanlineFill(Region &region, const int seed_i, const int seed_j, const int width, const int height,
+                  const vpImageMorphology::vpConnexityType &connexity, std::vector<vpFloodFillSpan> &spans) {
+  spans.clear();
+  fillSeedRun(region, seed_i, seed_j, width, spans);
+  scanlineFill(region, width, height, connexity, spans);
+}
+
+//Pixels equal to oldValue, filled in place with newValue
+class vpEqualValueRegion {
+public:
+  vpEqualValueRegion(vpImage<unsigned char> &I, const unsigned char oldValue, const unsigned char newValue) :
+    m_I(I), m_row(NULL), m_oldValue(oldValue), m_newValue(newValue) {
+  }
+
+  inline void setRow(const int i) {
+    m_row = m_I[i];
+  }
+
+  inline bool inside(const int j) const {
+    return m_row[j] == m_oldValue;
+  }
+
+  inline void fill(const int left, const int right) {
+    memset(m_row + left, m_newValue, sizeof(unsigned char) * (size_t) (right - left + 1));
+  }
+
+private:
+  vpImage<unsigned char> &m_I;
+  unsigned char *m_row;
+  unsigned char m_oldValue;
+  unsigned char m_newValue;
+};
+
+//Pixels equal to oldValue and not yet marked in a byte mask, the source image is not modified
+class vpMaskRegion {
+public:
+  vpMaskRegion(const vpImage<unsigned char> &I, vpImage<unsigned char> &mask, const unsigned char oldValue,
+               const unsigned char maskValue) :
+    m_I(I), m_mask(mask), m_row(NULL), m_maskRow(NULL), m_oldValue(oldValue), m_maskValue(maskValue) {
+  }
+
+  inline void setRow(const int i) {
+    m_row = m_I[i];
+    m_maskRow = m_mask[i];
+  }
+
+  inline bool inside(const int j) const {
+    return m_row[j] == m_oldValue && m_maskRow[j] != m_maskValue;
+  }
+
+  inline void fill(const int left, const int right) {
+    memset(m_maskRow + left, m_maskValue, sizeof(unsigned char) * (size_t) (right - left + 1));
+  }
+
+private:
+  const vpImage<unsigned char> &m_I;
+  vpImage<unsigned char> &m_mask;
+  const unsigned char *m_row;
+  unsigned char *m_maskRow;
+  unsigned char m_oldValue;
+  unsigned char m_maskValue;
+};
+
+//Pixels equal to oldValue and not yet set in a bit mask, the source image is not modified
+class vpBitMaskRegion {
+public:
+  vpBitMaskRegion(const vpImage<unsigned char> &I, vp::vpBitMask &mask, const unsigned char oldValue) :
+    m_I(I), m_mask(mask), m_row(NULL), m_i(0), m_oldValue(oldValue) {
+  }
+
+  inline void setRow(const int i) {
+    m_i = (unsigned int) i;
+    m_row = m_I[m_i];
+  }
+
+  inline bool inside(const int j) const {
+    return m_row[j] == m_oldValue && !m_mask.get(m_i, (unsigned int) j);
+  }
+
+  inline void fill(const int left, const int right) {
+    m_mask.setRange(m_i, (unsigned int) left, (unsigned int) right + 1);
+  }
+
+private:
+  const vpImage<unsigned char> &m_I;
+  vp::vpBitMask &m_mask;
+  const unsigned char *m_row;
+  unsigned int m_i;
+  unsigned char m_oldValue;
+};
+
+//Pixels not yet set in the visited bit mask with a value in [lowValue, highValue]. The image is not modified: the
+//filled runs are recorded and the statistics of the element k are updated.
+class vpValueRangeRegion {
+public:
+  vpValueRangeRegion(const vpImage<unsigned char> &I, vp::vpBitMask &visited, std::vector<vp::vpRun> &runs,
+                     vp::vpConnectedComponentsStats &stats) :
+    m_I(I), m_visited(visited), m_runs(runs), m_stats(stats), m_row(NULL), m_i(0), m_k(0), m_lowValue(0),
+    m_highValue(0) {
+  }
+
+  inline void setRange(const size_t k, const unsigned char lowValue, const unsigned char highValue) {
+    m_k = k;
+    m_lowValue = lowValue;
+    m_highValue = highValue;
+  }
+
+  inline void setRow(const int i) {
+    m_i = (unsigned int) i;
+    m_row = m_I[m_i];
+  }
+
+  inline bool inside(const int j) const {
+    return m_row[j] >= m_lowValue && m_row[j] <= m_highValue && !m_visited.get(m_i, (unsigned int) j);
+  }
+
+  void fill(const int left, const int right) {
+    m_visited.setRange(m_i, (unsigned int) left, (unsigned int) right + 1);
+    m_runs.push_back(vp::vpRun(m_i, (unsigned int) left, (unsigned int) right + 1));
+
+    unsigned int length = (unsigned int) (right - left + 1);
+    m_stats.m_area[m_k] += length;
+    m_stats.m_top[m_k] = std::min(m_stats.m_top[m_k], m_i);
+    m_stats.m_left[m_k] = std::min(m_stats.m_left[m_k], (unsigned int) left);
+    m_stats.m_bottom[m_k] = std::max(m_stats.m_bottom[m_k], m_i);
+    m_stats.m_right[m_k] = std::max(m_stats.m_right[m_k], (unsigned int) right);
+    m_stats.m_sumI[m_k] += length * (double) m_i;
+    m_stats.m_sumJ[m_k] += length * (left + right) / 2.0;
+  }
+
+private:
+  const vpImage<unsigned char> &m_I;
+  vp::vpBitMask &m_visited;
+  std::vector<vp::vpRun> &m_runs;
+  vp::vpConnectedComponentsStats &m_stats;
+  const unsigned char *m_row;
+  unsigned int m_i;
+  size_t m_k;
+  unsigned char m_lowValue;
+  unsigned char m_highValue;
+};
+
+//Fill the seeds one after the other on the original image, a pixel belongs to the first seed reaching it
+void floodFillSeeds(vpImage<unsigned char> &I, const std::vector<vpImagePoint> &seedPoints,
+                    const std::vector<unsigned char> &newValues, vp::vpConnectedComponentsStats &stats,
+                    const bool fixedRange, const unsigned char tolerance, const unsigned char lowValue,
+                    const unsigned char highValue, const vpImageMorphology::vpConnexityType &connexity) {
+  if (seedPoints.size() != newValues.size()) {
+    std::cerr << "seedPoints.size() != newValues.size()" << std::endl;
+    return;
+  }
+
+  stats = vp::vpConnectedComponentsStats();
+  stats.m_area.resize(seedPoints.size(), 0);
+  stats.m_top.resize(seedPoints.size(), std::numeric_limits<unsigned int>::max());
+  stats.m_left.resize(seedPoints.size(), std::numeric_limits<unsigned int>::max());
+  stats.m_bottom.resize(seedPoints.size(), 0);
+  stats.m_right.resize(seedPoints.size(), 0);
+  stats.m_sumI.resize(seedPoints.size(), 0.0);
+  stats.m_sumJ.resize(seedPoints.size(), 0.0);
+
+  if (I.getSize() == 0) {
+    return;
+  }
+
+  int width = (int) I.getWidth(), height = (int) I.getHeight();
+  vp::vpBitMask visited(I.getHeight(), I.getWidth());
+  std::vector<vp::vpRun> runs;
+  std::vector<size_t> seedRuns(seedPoints.size() + 1, 0);
+  std::vector<vpFloodFillSpan> spans;
+  vpValueRangeRegion region(I, visited, runs, stats);
+
+  for (size_t k = 0; k < seedPoints.size(); k++) {
+    int seed_i = (int) seedPoints[k].get_i(), seed_j = (int) seedPoints[k].get_j();
+
+    if (seed_i >= 0 && seed_i < height && seed_j >= 0 && seed_j < width) {
+      if (fixedRange) {
+        region.setRange(k, lowValue, highValue);
+      } else {
+        int seedValue = I[seed_i][seed_j];
+        region.setRange(k, (unsigned char) std::max(0, seedValue - tolerance),
+                        (unsigned char) std::min(255, seedValue + tolerance));
+      }
+
+      region.setRow(seed_i);
+      if (region.inside(seed_j)) {
+        scanlineFill(region, seed_i, seed_j, width, height, connexity, spans);
+      }
+    }
+
+    seedRuns[k + 1] = runs.size();
+  }
+
+  for (size_t k = 0; k < seedPoints.size(); k++) {
+    for (size_t cpt = seedRuns[k]; cpt < seedRuns[k + 1]; cpt++) {
+      memset(I[runs[cpt].m_row] + runs[cpt].m_begin, newValues[k],
+             sizeof(unsigned char) * (runs[cpt].m_end - runs[cpt].m_begin));
+    }
+  }
+}
+} //namespace
 
 /*!
   \ingroup group_imgproc_connected_components
 
-  Perform the flood fill algorithm.
+  Perform the flood fill algorithm. Scanline filling: each horizontal run of pixels equal to \e oldValue is filled at
+  once, and only the ranges of the rows above and below touching the run (extended by one pixel on each side
+  with 8-connexity) are scanned for new runs. Nothing is done if the seed pixel is not equal to \e oldValue.
 
   \param I : Input image to flood fill.
   \param seedPoint : Seed position in the image.
@@ -57,89 +345,188 @@
 */
 void vp::floodFill(vpImage<unsigned char> &I, const vpImagePoint &seedPoint, const unsigned char oldValue, const unsigned char newValue,
                    const vpImageMorphology::vpConnexityType &connexity) {
-  //Code from Lode Vandevenne tutorial.
-  //Naive modification for 8-connexity implementation
   if (oldValue == newValue || I.getSize() == 0) {
     return;
   }
 
-  std::queue<vpImagePoint> seed_queue;
+  int width = (int) I.getWidth(), height = (int) I.getHeight();
+  int seed_i = (int) seedPoint.get_i(), seed_j = (int) seedPoint.get_j();
+  if (seed_i < 0 || seed_i >= height || seed_j < 0 || seed_j >= width || I[seed_i][seed_j] != oldValue) {
+    return;
+  }
 
-  //Add initial seed point
-  seed_queue.push(seedPoint);
+  vpEqualValueRegion region(I, oldValue, newValue);
+  std::vector<vpFloodFillSpan> spans;
+  scanlineFill(region, seed_i, seed_j, width, height, connexity, spans);
+}
 
-  while ( !seed_queue.empty() ) {
-    vpImagePoint current_seed = seed_queue.front();
-    seed_queue.pop();
+/*!
+  \ingroup group_imgproc_connected_components
 
-    unsigned int x = current_seed.get_j();
-    unsigned int y = current_seed.get_i();
-    int x1 = (int) x;
+  Perform the flood fill algorithm from several seeds in one pass. The region of the seed k is the set of pixels
+  connected to the seed whose value v satisfies |v - seed value| <= \e tolerance, and it is filled with
+  \e newValues[k]. The regions are computed on the original image, in the order of the seeds, with a shared visited bit
+  mask: a pixel belongs to the first seed whose region reaches it, and a seed inside the region of a previous seed or
+  outside the image has an empty region.
 
-    //Find most left pixel
-    while (x1 >= 0 && I[y][x1] == oldValue) {
-      x1--;
-    }
-    x1++;
+  \param I : Input image to flood fill.
+  \param seedPoints : Seed positions in the image.
+  \param newValues : New value of each seed.
+  \param stats : Area, bounding box and sums of the coordinates of the region of each seed (the second order moments
+  are not computed). For an empty region, the area is 0 and the bounding box is not valid.
+  \param tolerance : Maximal difference between the value of a filled pixel and the value of the seed.
+  \param connexity : Type of connexity.
+*/
+void vp::floodFill(vpImage<unsigned char> &I, const std::vector<vpImagePoint> &seedPoints,
+                   const std::vector<unsigned char> &newValues, vpConnectedComponentsStats &stats,
+                   const unsigned char tolerance, const vpImageMorphology::vpConnexityType &connexity) {
+  floodFillSeeds(I, seedPoints, newValues, stats, false, tolerance, 0, 0, connexity);
+}
 
-    bool spanAbove = false, spanBelow = false;
+/*!
+  \ingroup group_imgproc_connected_components
 
-    while (x1 < (int) I.getWidth() && I[y][x1] == oldValue) {
-      I[y][x1] = newValue;
+  Perform the flood fill algorithm from several seeds in one pass, see
+  vp::floodFill(vpImage<unsigned char> &, const std::vector<vpImagePoint> &, const std::vector<unsigned char> &, vpConnectedComponentsStats &, const unsigned char, const vpImageMorphology::vpConnexityType &).
+  The region of the seed k is the set of pixels connected to the seed whose value is in the fixed range
+  [\e lowValue, \e highValue]. The region of a seed whose value is outside the range is empty.
 
-      if (!spanAbove && y > 0) {
-        if (I[y-1][x1] == oldValue) {
-          //North
-          spanAbove = true;
-          seed_queue.push( vpImagePoint(y-1, x1) );
-        }
+  \param I : Input image to flood fill.
+  \param seedPoints : Seed positions in the image.
+  \param newValues : New value of each seed.
+  \param stats : Area, bounding box and sums of the coordinates of the region of each seed.
+  \param lowValue : Smallest value of the filled pixels.
+  \param highValue : Largest value of the filled pixels.
+  \param connexity : Type of connexity.
+*/
+void vp::floodFill(vpImage<unsigned char> &I, const std::vector<vpImagePoint> &seedPoints,
+                   const std::vector<unsigned char> &newValues, vpConnectedComponentsStats &stats,
+                   const unsigned char lowValue, const unsigned char highValue,
+                   const vpImageMorphology::vpConnexityType &connexity) {
+  floodFillSeeds(I, seedPoints, newValues, stats, true, 0, lowValue, highValue, connexity);
+}
 
-        if (connexity != vpImageMorphology::CONNEXITY_4) {
-          if (x1 > 0 && I[y-1][x1-1] == oldValue) {
-            //North west
-            spanAbove = true;
-            seed_queue.push( vpImagePoint(y-1, x1-1) );
-          }
-          if (x1 < (int) I.getWidth()-1 && I[y-1][x1+1] == oldValue) {
-            //North east
-            spanAbove = true;
-            seed_queue.push( vpImagePoint(y-1, x1+1) );
-          }
-        }
-      } else if (spanAbove && y > 0 && I[y-1][x1] != oldValue) {
-        spanAbove = false;
-      }
+/*!
+  \ingroup group_imgproc_connected_components
 
-      if (!spanBelow && y < I.getHeight()-1) {
-        if (I[y+1][x1] == oldValue) {
-          //South
-          seed_queue.push( vpImagePoint(y+1, x1) );
-          spanBelow = true;
-        }
+  Perform the flood fill algorithm without modifying the input image: the region of pixels equal to \e oldValue
+  connected to the seed is marked with \e maskValue in \e mask. The pixels already equal to \e maskValue in
+  \e mask are not filled, so that successive calls with different seeds accumulate in the same mask. The mask is
+  resized and set to 0 if its size is not the size of the image. Nothing is done if the seed pixel is not equal to
+  \e oldValue or is already marked.
 
-        if (connexity != vpImageMorphology::CONNEXITY_4) {
-          if (x1 > 0 && I[y+1][x1-1] == oldValue) {
-            //South west
-            seed_queue.push( vpImagePoint(y+1, x1-1) );
-            spanBelow = true;
-          }
-          if (x1 < (int) I.getWidth()-1 && I[y+1][x1+1] == oldValue) {
-            //South east
-            seed_queue.push( vpImagePoint(y+1, x1+1) );
-            spanBelow = true;
-          }
-        }
-      } else if (spanBelow && y < I.getHeight()-1 && I[y+1][x1] != oldValue) {
-        spanBelow = false;
-      }
+  \param I : Input image.
+  \param mask : Output mask.
+  \param seedPoint : Seed position in the image.
+  \param oldValue : Value of the pixels of the region.
+  \param maskValue : Value of the marked pixels in the mask (must not be 0).
+  \param connexity : Type of connexity.
+*/
+void vp::floodFill(const vpImage<unsigned char> &I, vpImage<unsigned char> &mask, const vpImagePoint &seedPoint,
+                   const unsigned char oldValue, const unsigned char maskValue,
+                   const vpImageMorphology::vpConnexityType &connexity) {
+  if (maskValue == 0) {
+    std::cerr << "maskValue must not be 0!" << std::endl;
+    return;
+  }
+
+  if (mask.getHeight() != I.getHeight() || mask.getWidth() != I.getWidth()) {
+    mask.resize(I.getHeight(), I.getWidth(), 0);
+  }
+
+  int width = (int) I.getWidth(), height = (int) I.getHeight();
+  int seed_i = (int) seedPoint.get_i(), seed_j = (int) seedPoint.get_j();
+  if (seed_i < 0 || seed_i >= height || seed_j < 0 || seed_j >= width) {
+    return;
+  }
+
+  vpMaskRegion region(I, mask, oldValue, maskValue);
+  region.setRow(seed_i);
+  if (region.inside(seed_j)) {
+    std::vector<vpFloodFillSpan> spans;
+    scanlineFill(region, seed_i, seed_j, width, height, connexity, spans);
+  }
+}
+
+/*!
+  \ingroup group_imgproc_connected_components
+
+  Perform the flood fill algorithm without modifying the input image, the region being set in a mask with 1 bit per
+  pixel, see
+  vp::floodFill(const vpImage<unsigned char> &, vpImage<unsigned char> &, const vpImagePoint &, const unsigned char, const unsigned char, const vpImageMorphology::vpConnexityType &).
+
+  \param I : Input image.
+  \param mask : Output mask, resized and cleared if its size is not the size of the image.
+  \param seedPoint : Seed position in the image.
+  \param oldValue : Value of the pixels of the region.
+  \param connexity : Type of connexity.
+*/
+void vp::floodFill(const vpImage<unsigned char> &I, vpBitMask &mask, const vpImagePoint &seedPoint,
+                   const unsigned char oldValue, const vpImageMorphology::vpConnexityType &connexity) {
+  if (mask.getHeight() != I.getHeight() || mask.getWidth() != I.getWidth()) {
+    mask.resize(I.getHeight(), I.getWidth());
+  }
+
+  int width = (int) I.getWidth(), height = (int) I.getHeight();
+  int seed_i = (int) seedPoint.get_i(), seed_j = (int) seedPoint.get_j();
+  if (seed_i < 0 || seed_i >= height || seed_j < 0 || seed_j >= width) {
+    return;
+  }
 
-      //TODO: improve 8-connexity
-      if (connexity != vpImageMorphology::CONNEXITY_4) {
-        spanBelow = false;
-        spanAbove = false;
+  vpBitMaskRegion region(I, mask, oldValue);
+  region.setRow(seed_i);
+  if (region.inside(seed_j)) {
+    std::vector<vpFloodFillSpan> spans;
+    scanlineFill(region, seed_i, seed_j, width, height, connexity, spans);
+  }
+}
+
+/*!
+  \ingroup group_imgproc_connected_components
+
+  Perform the flood fill algorithm from all the pixels of the image border equal to \e oldValue, without modifying the
+  input image: the pixels equal to \e oldValue connected to the border are set in \e mask. All the runs of the
+  first and last rows and the runs touching the first or last column are seeded, then filled in a single scanline
+  traversal. The pixels already set in \e mask are not filled.
+
+  \param I : Input image.
+  \param mask : Output mask, resized and cleared if its size is not the size of the image.
+  \param oldValue : Value of the pixels of the region.
+  \param connexity : Type of connexity.
+*/
+void vp::floodFillBorder(const vpImage<unsigned char> &I, vpBitMask &mask, const unsigned char oldValue,
+                         const vpImageMorphology::vpConnexityType &connexity) {
+  if (mask.getHeight() != I.getHeight() || mask.getWidth() != I.getWidth()) {
+    mask.resize(I.getHeight(), I.getWidth());
+  }
+
+  if (I.getSize() == 0) {
+    return;
+  }
+
+  int width = (int) I.getWidth(), height = (int) I.getHeight();
+  vpBitMaskRegion region(I, mask, oldValue);
+  std::vector<vpFloodFillSpan> spans;
+
+  for (int i = 0; i < height; i += std::max(1, height-1)) {
+    region.setRow(i);
+    for (int j = 0; j < width; j++) {
+      if (region.inside(j)) {
+        fillSeedRun(region, i, j, width, spans);
+        region.setRow(i);
       }
+    }
+  }
 
-      x1++;
+  for (int i = 1; i < height-1; i++) {
+    region.setRow(i);
+    if (region.inside(0)) {
+      fillSeedRun(region, i, 0, width, spans);
+    }
+    if (region.inside(width-1)) {
+      fillSeedRun(region, i, width-1, width, spans);
     }
   }
+
+  scanlineFill(region, width, height, connexity, spans);
 }
@@ -197,6 +197,69 @@ void vp::equalizeHistogram(const vpImage<unsigned char> &I1, vpImage<unsigned ch
   vp::equalizeHistogram(I2);
 }
 
+/*!
+  \ingroup group_imgproc_histogram
+
+  Adjust the contrast of a 16-bit grayscale image by performing an histogram equalization.
+  The intensity distribution is redistributed over the full [0 - 65535] range such as the cumulative histogram
+  distribution becomes linear. The histogram is computed only between the minimum and the maximum values of the image.
+
+  \param I : The 16-bit grayscale image to apply histogram equalization.
+*/
+void vp::equalizeHistogram(vpImage<unsigned short> &I) {
+  if(I.getWidth()*I.getHeight() == 0) {
+    return;
+  }
+
+  unsigned int nbPixels = I.getWidth()*I.getHeight();
+  unsigned short minValue = 65535, maxValue = 0;
+  for (unsigned int i = 0; i < nbPixels; i++) {
+    minValue = std::min(minValue, I.bitmap[i]);
+    maxValue = std::max(maxValue, I.bitmap[i]);
+  }
+
+  if (minValue == maxValue) {
+    //Only one brightness value in the image
+    return;
+  }
+
+  //Calculate the histogram and the cumulative distribution function for the range [minValue, maxValue]
+  std::vector<unsigned int> cdf((size_t) (maxValue - minValue + 1), 0);
+  for (unsigned int i = 0; i < nbPixels; i++) {
+    cdf[(size_t) (I.bitmap[i] - minValue)]++;
+  }
+
+  for (size_t i = 1; i < cdf.size(); i++) {
+    cdf[i] += cdf[i-1];
+  }
+
+  //Construct the look-up table
+  unsigned int cdfMin = cdf[0];
+  std::vector<unsigned short> lut(cdf.size());
+  for (size_t i = 0; i < lut.size(); i++) {
+    lut[i] = (unsigned short) vpMath::round( (cdf[i]-cdfMin) / (double) (nbPixels-cdfMin) * 65535.0 );
+  }
+
+  for (unsigned int i = 0; i < nbPixels; i++) {
+    I.bitmap[i] = lut[(size_t) (I.bitmap[i] - minValue)];
+  }
+}
+
+/*!
+  \ingroup group_imgproc_histogram
+
+  Adjust the contrast of a 16-bit grayscale image by performing an histogram equalization.
+  The intensity distribution is redistributed over the full [0 - 65535] range such as the cumulative histogram
+  distribution becomes linear.
+
+  \param I1 : The first 16-bit grayscale image.
+  \param I2 : The second 16-bit grayscale image after histogram equalization.
+*/
+void vp::equalizeHistogram(const vpImage<unsigned short> &I1, vpImage<unsigned short> &I2) {
+  I2 = I1;
+  vp::equalizeHistogram(I2);
+}
+
 /*!
   \ingroup group_imgproc_histogram
 
@@ -40,84 +40,140 @@
   \brief Additional image morphology functions.
 */
 
+#include <algorithm>
+#include <queue>
 #include <visp3/imgproc/vpImgproc.h>
-#include <visp3/core/vpImageTools.h>
 
-/*!
-  \ingroup group_imgproc_morph
-
-  Fill the holes in a binary image.
-
-  \param I : Input binary image (0 means background, 255 means foreground).
-*/
-void vp::fillHoles(vpImage<unsigned char> &I
-#if USE_OLD_FILL_HOLE
-                   , const vpImageMorphology::vpConnexityType &connexity
-#endif
-                   ) {
-  if (I.getSize() == 0) {
-    return;
-  }
-
-#if USE_OLD_FILL_HOLE
-  //Code similar to Matlab imfill(BW,'holes')
-  //Replaced by flood fill as imfill use imreconstruct
-  //and our reconstruct implementation is naive and inefficient
-  //Difference between new and old implementation:
-  //  - new implementation allows to set the fill value
-  //  - only background==0 is required, before it was 0 (background) / 1 (foreground)
-  //  - no more connexity option
-  vpImage<unsigned char> mask(I.getHeight() + 2, I.getWidth() + 2, 255);
-  //Copy I to mask + add border padding + complement
-  for (unsigned int i = 0; i < I.getHeight(); i++) {
-    for (unsigned int j = 0; j < I.getWidth(); j++) {
-      mask[i+1][j+1] = 255 - I[i][j];
+namespace {
+//Offsets of the neighbors, the first 4 ones are the 4-connexity neighbors
+const int neighbor_i[8] = {-1, 0, 0, 1, -1, -1, 1, 1};
+const int neighbor_j[8] = {0, -1, 1, 0, -1, 1, -1, 1};
+
+//Hybrid reconstruction from Luc Vincent, "Morphological grayscale reconstruction in image analysis: applications and
+//efficient algorithms", IEEE Transactions on Image Processing, 1993. J must be below the mask on input.
+void reconstructHybrid(const vpImage<unsigned char> &mask, vpImage<unsigned char> &J,
+                       const vpImageMorphology::vpConnexityType &connexity) {
+  int height = (int) J.getHeight(), width = (int) J.getWidth();
+  bool connex8 = connexity == vpImageMorphology::CONNEXITY_8;
+
+  //Raster scan: propagate from the neighbors already scanned (left and above)
+  for (int i = 0; i < height; i++) {
+    unsigned char *row = J[i];
+    const unsigned char *prevRow = i > 0 ? J[i-1] : NULL;
+    const unsigned char *maskRow = mask[i];
+
+    for (int j = 0; j < width; j++) {
+      unsigned char value = row[j];
+      if (j > 0) {
+        value = std::max(value, row[j-1]);
+      }
+      if (prevRow != NULL) {
+        value = std::max(value, prevRow[j]);
+        if (connex8) {
+          if (j > 0) {
+            value = std::max(value, prevRow[j-1]);
+          }
+          if (j+1 < width) {
+            value = std::max(value, prevRow[j+1]);
+          }
+        }
+      }
+      row[j] = std::min(value, maskRow[j]);
     }
   }
 
-  vpImage<unsigned char> marker(I.getHeight() + 2, I.getWidth() + 2, 0);
-  //Create marker with 255 1-pixel border
-  for (unsigned int i = 0; i < marker.getHeight(); i++) {
-    if (i == 0 || i == marker.getHeight()-1) {
-      for (unsigned int j = 0; j < marker.getWidth(); j++) {
-        marker[i][j] = 255;
+  //Anti-raster scan: propagate from the neighbors right and below, and queue the pixels which can still propagate
+  //to one of these neighbors
+  std::queue<unsigned int> fifo;
+  for (int i = height-1; i >= 0; i--) {
+    unsigned char *row = J[i];
+    const unsigned char *nextRow = i+1 < height ? J[i+1] : NULL;
+    const unsigned char *maskRow = mask[i];
+    const unsigned char *nextMaskRow = i+1 < height ? mask[i+1] : NULL;
+
+    for (int j = width-1; j >= 0; j--) {
+      unsigned char value = row[j];
+      if (j+1 < width) {
+        value = std::max(value, row[j+1]);
+      }
+      if (nextRow != NULL) {
+        value = std::max(value, nextRow[j]);
+        if (connex8) {
+          if (j > 0) {
+            value = std::max(value, nextRow[j-1]);
+          }
+          if (j+1 < width) {
+            value = std::max(value, nextRow[j+1]);
+          }
+        }
+      }
+      value = std::min(value, maskRow[j]);
+      row[j] = value;
+
+      bool propagate = j+1 < width && row[j+1] < value && row[j+1] < maskRow[j+1];
+      if (!propagate && nextRow != NULL) {
+        propagate = nextRow[j] < value && nextRow[j] < nextMaskRow[j];
+        if (!propagate && connex8) {
+          propagate = (j > 0 && nextRow[j-1] < value && nextRow[j-1] < nextMaskRow[j-1]) ||
+                      (j+1 < width && nextRow[j+1] < value && nextRow[j+1] < nextMaskRow[j+1]);
+        }
+      }
+      if (propagate) {
+        fifo.push((unsigned int) (i*width + j));
       }
-    } else {
-      marker[i][0] = 255;
-      marker[i][marker.getWidth()-1] = 255;
     }
   }
 
-  vpImage<unsigned char> I_reconstruct;
-  reconstruct(marker, mask, I_reconstruct, connexity);
+  //Propagation with a FIFO queue until stability
+  int nbNeighbors = connex8 ? 8 : 4;
+  while (!fifo.empty()) {
+    unsigned int index = fifo.front();
+    fifo.pop();
+
+    int i = (int) index / width, j = (int) index % width;
+    unsigned char value = J.bitmap[index];
+    for (int k = 0; k < nbNeighbors; k++) {
+      int ni = i + neighbor_i[k], nj = j + neighbor_j[k];
+      if (ni < 0 || ni >= height || nj < 0 || nj >= width) {
+        continue;
+      }
 
-  for (unsigned int i = 0; i < I.getHeight(); i++) {
-    for (unsigned int j = 0; j < I.getWidth(); j++) {
-      I[i][j] = 255 - I_reconstruct[i+1][j+1];
+      unsigned int neighborIndex = (unsigned int) (ni*width + nj);
+      if (J.bitmap[neighborIndex] < value && J.bitmap[neighborIndex] != mask.bitmap[neighborIndex]) {
+        J.bitmap[neighborIndex] = std::min(value, mask.bitmap[neighborIndex]);
+        fifo.push(neighborIndex);
+      }
     }
   }
-#else
-  //Create flood fill mask
-  vpImage<unsigned char> flood_fill_mask(I.getHeight() + 2, I.getWidth() + 2, 0);
-  //Copy I to mask + add border padding
-  for (unsigned int i = 0; i < I.getHeight(); i++) {
-    memcpy(flood_fill_mask[i+1]+1, I[i], sizeof(unsigned char)*I.getWidth());
-  }
+}
+} //namespace
+
+/*!
+  \ingroup group_imgproc_morph
 
-  //Perform flood fill
-  vp::floodFill(flood_fill_mask, vpImagePoint(0,0), 0, 255);
+  Fill the holes in a binary image: the background pixels that cannot be reached from the border of the image are set
+  to 255. The background connected to the border is marked in a bit mask with vp::floodFillBorder(), then the image is
+  binarized in place: the pixels of this background are set to 0 and the other pixels, foreground and holes, to 255.
 
-  //Get current mask
-  vpImage<unsigned char> mask(I.getHeight(), I.getWidth());
-  for (unsigned int i = 0; i < mask.getHeight(); i++) {
-    memcpy(mask[i], flood_fill_mask[i+1]+1, sizeof(unsigned char)*mask.getWidth());
+  \param I : Input binary image (0 means background, other values mean foreground and are set to 255).
+  \param connexity : Connexity of the background.
+*/
+void vp::fillHoles(vpImage<unsigned char> &I, const vpImageMorphology::vpConnexityType &connexity) {
+  if (I.getSize() == 0) {
+    return;
   }
 
-  //Get image with holes filled
-  vpImage<unsigned char> I_white(I.getHeight(), I.getWidth(), 255), I_holes;
-  vpImageTools::imageSubtract(I_white, mask, I_holes);
-  vpImageTools::imageAdd(I, I_holes, I, true);
-#endif
+  vpBitMask reached(I.getHeight(), I.getWidth());
+  floodFillBorder(I, reached, 0, connexity);
+
+  for (unsigned int i = 0; i < I.getHeight(); i++) {
+    unsigned char *row = I[i];
+    for (unsigned int j = 0; j < I.getWidth(); j++) {
+      if (row[j] != 0 || !reached.get(i, j)) {
+        row[j] = 255;
+      }
+    }
+  }
 }
 
 /*!
@@ -132,6 +188,9 @@ void vp::fillHoles(vpImage<unsigned char> &I
   \f]
   with \f$ k \f$ such that: \f$ D_{g}^{\left ( k \right )} \left ( f \right ) = D_{g}^{\left ( k+1 \right )} \left ( f \right ) \f$
 
+  After the first geodesic dilatation, the iterations are replaced by the hybrid algorithm of Luc Vincent: a raster
+  scan and an anti-raster scan propagate the values, then the remaining changes are propagated with a FIFO queue.
+
   \param marker : Grayscale image marker.
   \param mask : Grayscale image mask.
   \param h_kp1 : Image morphologically reconstructed.
@@ -149,24 +208,15 @@ void vp::reconstruct(const vpImage<unsigned char> &marker, const vpImage<unsigne
     return;
   }
 
-  vpImage<unsigned char> h_k = marker;
-  h_kp1 = h_k;
-
-  do {
-    //Dilatation
-    vpImageMorphology::dilatation(h_kp1, connexity);
-
-    //Keep min
-    for (unsigned int i = 0; i < h_kp1.getHeight(); i++) {
-      for (unsigned int j = 0; j < h_kp1.getWidth(); j++) {
-        h_kp1[i][j] = std::min(h_kp1[i][j], mask[i][j]);
-      }
-    }
-
-    if (h_kp1 == h_k) {
-      break;
+  //First geodesic dilatation, the marker is not required to be below the mask
+  h_kp1 = marker;
+  vpImageMorphology::dilatation(h_kp1, connexity);
+  for (unsigned int i = 0; i < h_kp1.getHeight(); i++) {
+    for (unsigned int j = 0; j < h_kp1.getWidth(); j++) {
+      h_kp1[i][j] = std::min(h_kp1[i][j], mask[i][j]);
     }
+  }
 
-    h_k = h_kp1;
-  } while (true);
+  //Geodesic dilatations until stability
+  reconstructHybrid(mask, h_kp1, connexity);
 }
@@ -40,15 +40,547 @@
   \brief Retinex algorithm
 */
 
-#include <numeric>
-#include <functional>
+#include <algorithm>
+#include <limits>
 
 #include <visp3/imgproc/vpImgproc.h>
 #include <visp3/core/vpMath.h>
 #include <visp3/core/vpImageFilter.h>
 
+#if defined VISP_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #define MAX_RETINEX_SCALES 8
 
+namespace {
+  struct vpRecursiveGaussianCoefficients {
+    double B, a1, a2, a3;
+  };
+
+  //Young, I. T., & van Vliet, L. J. (1995). Recursive implementation of the Gaussian filter.
+  //Signal Processing, 44(2), 139-151.
+  vpRecursiveGaussianCoefficients computeRecursiveGaussianCoefficients(double sigma) {
+    sigma = std::max(sigma, 0.5);
+    double q = sigma >= 2.5 ? 0.98711*sigma - 0.96330 : 3.97156 - 4.14554*std::sqrt(1.0 - 0.26891*sigma);
+    double q2 = q*q, q3 = q2*q;
+
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    double b1 = 2.44413*q + 2.85619*q2 + 1.26661*q3;
+    double b2 = -(1.4281*q2 + 1.26661*q3);
+    double b3 = 0.422205*q3;
+
+    vpRecursiveGaussianCoefficients coefs;
+    coefs.a1 = b1 / b0;
+    coefs.a2 = b2 / b0;
+    coefs.a3 = b3 / b0;
+    coefs.B = 1.0 - (coefs.a1 + coefs.a2 + coefs.a3);
+
+    return coefs;
+  }
+
+  //Mirror (without repeating the border sample, as vpImageFilter::gaussianBlur does) index i into [0, n-1],
+  //the mirrored signal being periodic when i is far outside the image
+  inline unsigned int reflectIndex(const int i, const unsigned int n) {
+    if (n == 1) {
+      return 0;
+    }
+
+    int period = 2*((int) n-1);
+    int index = i % period;
+    if (index < 0) {
+      index += period;
+    }
+
+    return (unsigned int) (index >= (int) n ? period - index : index);
+  }
+
+  //Copy n samples spaced by stride in buffer, mirrored on pad samples at both ends.
+  //The filtering is always done in double precision.
+  template <typename Type>
+  void loadMirroredLine(const Type *line, const unsigned int n, const unsigned int stride, const unsigned int pad,
+                        std::vector<double> &buffer) {
+    double *buf = &buffer[0];
+    for (unsigned int i = 0; i < n; i++) {
+      buf[pad + i] = line[i*stride];
+    }
+    for (unsigned int i = 1; i <= pad; i++) {
+      buf[pad - i] = buf[pad + reflectIndex(-(int) i, n)];
+      buf[pad + n - 1 + i] = buf[pad + reflectIndex((int) (n - 1 + i), n)];
+    }
+  }
+
+  //The mirrored margins warm up the causal and anti-causal passes
+  template <typename Type>
+  void recursiveGaussianLine(Type *line, const unsigned int n, const unsigned int stride, const unsigned int pad,
+                             const vpRecursiveGaussianCoefficients &coefs, std::vector<double> &buffer) {
+    loadMirroredLine(line, n, stride, pad, buffer);
+
+    double *buf = &buffer[0];
+    unsigned int size = n + 2*pad;
+    double w1 = buf[0], w2 = buf[0], w3 = buf[0];
+    for (unsigned int i = 0; i < size; i++) {
+      double w0 = coefs.B*buf[i] + coefs.a1*w1 + coefs.a2*w2 + coefs.a3*w3;
+      buf[i] = w0;
+      w3 = w2;
+      w2 = w1;
+      w1 = w0;
+    }
+
+    w1 = w2 = w3 = buf[size-1];
+    for (unsigned int i = size; i-- > 0;) {
+      double w0 = coefs.B*buf[i] + coefs.a1*w1 + coefs.a2*w2 + coefs.a3*w3;
+      buf[i] = w0;
+      w3 = w2;
+      w2 = w1;
+      w1 = w0;
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+      line[i*stride] = (Type) buf[pad + i];
+    }
+  }
+
+  //Symmetric kernel of 2*(kernel.size()-1)+1 taps
+  template <typename Type>
+  void kernelGaussianLine(Type *line, const unsigned int n, const unsigned int stride, const std::vector<double> &kernel,
+                          std::vector<double> &buffer) {
+    unsigned int pad = (unsigned int) kernel.size() - 1;
+    loadMirroredLine(line, n, stride, pad, buffer);
+
+    for (unsigned int i = 0; i < n; i++) {
+      const double *buf = &buffer[pad + i];
+      double value = kernel[0]*buf[0];
+      for (unsigned int k = 1; k <= pad; k++) {
+        value += kernel[k]*(*(buf - k) + buf[k]);
+      }
+      line[i*stride] = (Type) value;
+    }
+  }
+
+  //Separable recursive Gaussian blur, apart from the 3 sigma margins the cost per pixel does not depend on sigma
+  template <typename Type>
+  void recursiveGaussianBlur(const vpImage<Type> &I, vpImage<Type> &GI, const double sigma, std::vector<double> &buffer) {
+    unsigned int width = I.getWidth(), height = I.getHeight();
+    unsigned int pad = (unsigned int) std::ceil(3.0*sigma);
+    buffer.resize(std::max(width, height) + 2*pad);
+    GI = I;
+
+    //The recursive approximation is the least accurate for small sigmas, where a kernel is cheap anyway
+    const unsigned int maxKernelSize = 25;
+    if (2*pad + 1 <= maxKernelSize) {
+      std::vector<double> kernel(pad + 1);
+      double sum = 0.0;
+      for (unsigned int k = 0; k <= pad; k++) {
+        kernel[k] = std::exp(-(double) (k*k) / (2.0*sigma*sigma));
+        sum += k == 0 ? kernel[k] : 2.0*kernel[k];
+      }
+      for (unsigned int k = 0; k <= pad; k++) {
+        kernel[k] /= sum;
+      }
+
+      for (unsigned int i = 0; i < height; i++) {
+        kernelGaussianLine(GI[i], width, 1, kernel, buffer);
+      }
+      for (unsigned int j = 0; j < width; j++) {
+        kernelGaussianLine(GI.bitmap + j, height, width, kernel, buffer);
+      }
+      return;
+    }
+
+    vpRecursiveGaussianCoefficients coefs = computeRecursiveGaussianCoefficients(sigma);
+    for (unsigned int i = 0; i < height; i++) {
+      recursiveGaussianLine(GI[i], width, 1, pad, coefs, buffer);
+    }
+    for (unsigned int j = 0; j < width; j++) {
+      recursiveGaussianLine(GI.bitmap + j, height, width, pad, coefs, buffer);
+    }
+  }
+
+  //Truncated kernel of vpImageFilter::gaussianBlur, computed in double precision
+  void kernelGaussianBlur(const vpImage<double> &I, vpImage<double> &GI, const unsigned int kernelSize, const double sigma) {
+    vpImageFilter::gaussianBlur(I, GI, kernelSize, sigma);
+  }
+
+  //Convolution of a line with the truncated kernel of vpImageFilter::gaussianBlur and the same borders as
+  //vpImageFilter::filterX() and filterY(): mirrored without repeating the first sample, and repeating the last one
+  template <typename Type>
+  void truncatedGaussianLine(Type *line, const unsigned int n, const unsigned int stride,
+                             const std::vector<double> &kernel, std::vector<double> &buffer) {
+    unsigned int pad = (unsigned int) kernel.size() - 1;
+    double *buf = &buffer[0];
+    for (unsigned int i = 0; i < n; i++) {
+      buf[pad + i] = line[i*stride];
+    }
+    for (unsigned int i = 1; i <= pad; i++) {
+      buf[pad - i] = buf[pad + std::min(i, n - 1)];
+      buf[pad + n - 1 + i] = buf[pad + (i <= n ? n - i : 0)];
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+      const double *center = &buf[pad + i];
+      double value = 0.0;
+      for (unsigned int k = 1; k <= pad; k++) {
+        value += kernel[k]*(center[k] + *(center - k));
+      }
+      line[i*stride] = (Type) (value + kernel[0]*center[0]);
+    }
+  }
+
+  //Same blur in single precision, computed in place in GI with the buffers of the worker
+  void kernelGaussianBlur(const vpImage<float> &I, vpImage<float> &GI, const unsigned int kernelSize, const double sigma,
+                          std::vector<double> &kernel, std::vector<double> &buffer) {
+    unsigned int width = I.getWidth(), height = I.getHeight();
+    kernel.resize((kernelSize + 1) / 2);
+    vpImageFilter::getGaussianKernel(&kernel[0], kernelSize, sigma, true);
+    buffer.resize(std::max(width, height) + 2*(kernel.size() - 1));
+    GI = I;
+
+    for (unsigned int i = 0; i < height; i++) {
+      truncatedGaussianLine(GI[i], width, 1, kernel, buffer);
+    }
+    for (unsigned int j = 0; j < width; j++) {
+      truncatedGaussianLine(GI.bitmap + j, height, width, kernel, buffer);
+    }
+  }
+
+  void kernelGaussianBlur(const vpImage<double> &I, vpImage<double> &GI, const unsigned int kernelSize, const double sigma,
+                          std::vector<double> &, std::vector<double> &) {
+    kernelGaussianBlur(I, GI, kernelSize, sigma);
+  }
+
+  //Binomial [1 4 6 4 1]/16 low-pass filter (sigma = 1 pixel) followed by a decimation by 2.
+  //One mirrored sample is kept past the border so that the last pixels can be bilinearly interpolated.
+  template <typename Type>
+  void pyramidDown(const vpImage<Type> &I, vpImage<Type> &Idown) {
+    unsigned int width = I.getWidth(), height = I.getHeight();
+    unsigned int widthDown = width/2 + 1, heightDown = height/2 + 1;
+
+    vpImage<Type> Itmp(height, widthDown);
+    for (unsigned int i = 0; i < height; i++) {
+      const Type *src = I[i];
+      Type *dst = Itmp[i];
+      for (unsigned int j = 0; j < widthDown; j++) {
+        int x = (int) (2*j);
+        if (x >= 2 && x+2 < (int) width) {
+          dst[j] = (Type) ((src[x-2] + src[x+2] + 4.0*(src[x-1] + src[x+1]) + 6.0*src[x]) / 16.0);
+        } else {
+          dst[j] = (Type) ((src[reflectIndex(x-2, width)] + src[reflectIndex(x+2, width)] +
+              4.0*(src[reflectIndex(x-1, width)] + src[reflectIndex(x+1, width)]) + 6.0*src[reflectIndex(x, width)]) / 16.0);
+        }
+      }
+    }
+
+    Idown.resize(heightDown, widthDown);
+    for (unsigned int i = 0; i < heightDown; i++) {
+      int y = (int) (2*i);
+      const Type *src_2 = Itmp[reflectIndex(y-2, height)], *src_1 = Itmp[reflectIndex(y-1, height)];
+      const Type *src0 = Itmp[reflectIndex(y, height)], *src1 = Itmp[reflectIndex(y+1, height)];
+      const Type *src2 = Itmp[reflectIndex(y+2, height)];
+      Type *dst = Idown[i];
+      for (unsigned int j = 0; j < widthDown; j++) {
+        dst[j] = (Type) ((src_2[j] + src2[j] + 4.0*(src_1[j] + src1[j]) + 6.0*src0[j]) / 16.0);
+      }
+    }
+  }
+
+  //Levels 1 and above of the Gaussian pyramid of I, the full resolution level is I itself
+  template <typename Type>
+  void buildGaussianPyramid(const vpImage<Type> &I, std::vector<vpImage<Type> > &pyramid) {
+    const unsigned int minSize = 8;
+    unsigned int nbLevels = 0;
+    for (unsigned int size = std::min(I.getWidth(), I.getHeight()); size >= 2*minSize; size = size/2 + 1) {
+      nbLevels++;
+    }
+
+    pyramid.resize(nbLevels);
+    for (unsigned int level = 0; level < nbLevels; level++) {
+      pyramidDown(level == 0 ? I : pyramid[level-1], pyramid[level]);
+    }
+  }
+
+  //Bilinear upsampling, pixel (i, j) of I samples pixel (i*factor, j*factor) of Iup
+  template <typename Type>
+  void upsampleBilinear(const vpImage<Type> &I, const unsigned int factor, vpImage<Type> &Iup) {
+    unsigned int width = Iup.getWidth(), height = Iup.getHeight();
+    unsigned int widthSrc = I.getWidth(), heightSrc = I.getHeight();
+
+    std::vector<unsigned int> x0(width), x1(width);
+    std::vector<Type> fx(width);
+    for (unsigned int j = 0; j < width; j++) {
+      x0[j] = std::min(j / factor, widthSrc-1);
+      x1[j] = std::min(x0[j]+1, widthSrc-1);
+      fx[j] = (Type) ((j - x0[j]*factor) / (double) factor);
+    }
+
+    for (unsigned int i = 0; i < height; i++) {
+      unsigned int y0 = std::min(i / factor, heightSrc-1);
+      unsigned int y1 = std::min(y0+1, heightSrc-1);
+      Type fy = (Type) ((i - y0*factor) / (double) factor);
+      const Type *src0 = I[y0], *src1 = I[y1];
+      Type *dst = Iup[i];
+
+      for (unsigned int j = 0; j < width; j++) {
+        Type top = src0[x0[j]] + fx[j]*(src0[x1[j]] - src0[x0[j]]);
+        Type bottom = src1[x0[j]] + fx[j]*(src1[x1[j]] - src1[x0[j]]);
+        dst[j] = top + fy*(bottom - top);
+      }
+    }
+  }
+
+  //Blur at the coarsest pyramid level whose sampling still resolves sigma, then upsample
+  template <typename Type>
+  void pyramidGaussianBlur(const vpImage<Type> &I, const std::vector<vpImage<Type> > &pyramid, vpImage<Type> &GI,
+                           const double sigma, vpImage<Type> &Iblur, std::vector<double> &buffer) {
+    unsigned int level = 0;
+    while (level < pyramid.size() && 4.0*(1 << (level+1)) <= sigma) {
+      level++;
+    }
+
+    if (level == 0) {
+      recursiveGaussianBlur(I, GI, sigma, buffer);
+      return;
+    }
+
+    //Each pyramid level adds a Gaussian of standard deviation 2^k pixels, k = 0 .. level-1
+    unsigned int factor = 1u << level;
+    double pyramidVariance = (factor*factor - 1) / 3.0;
+    double sigmaLevel = std::sqrt(std::max(sigma*sigma - pyramidVariance, 0.0)) / factor;
+
+    recursiveGaussianBlur(pyramid[level-1], Iblur, sigmaLevel, buffer);
+
+    GI.resize(I.getHeight(), I.getWidth());
+    upsampleBilinear(Iblur, factor, GI);
+  }
+
+  //Shift the pixel values by 1 to avoid problem with log(0)
+  template <typename Type>
+  void extractChannel(const vpImage<vpRGBa> &I, const int channel, vpImage<Type> &Ichannel) {
+    Ichannel.resize(I.getHeight(), I.getWidth());
+    unsigned int size = I.getSize();
+
+    switch(channel) {
+    case 0:
+      for(unsigned int cpt = 0; cpt < size; cpt++) {
+        Ichannel.bitmap[cpt] = (Type) (I.bitmap[cpt].R + 1.0);
+      }
+      break;
+
+    case 1:
+      for(unsigned int cpt = 0; cpt < size; cpt++) {
+        Ichannel.bitmap[cpt] = (Type) (I.bitmap[cpt].G + 1.0);
+      }
+      break;
+
+    default:
+      for(unsigned int cpt = 0; cpt < size; cpt++) {
+        Ichannel.bitmap[cpt] = (Type) (I.bitmap[cpt].B + 1.0);
+      }
+      break;
+    }
+  }
+
+  //Scratch buffers of a worker
+  template <typename Type>
+  struct vpRetinexBuffers {
+    vpImage<Type> blurImage;
+    vpImage<Type> pyramidBlurImage;
+    std::vector<double> lineBuffer;
+    std::vector<double> kernel;
+  };
+
+  //Compute in res[i] the sum over the scales of the log of the surrounds of images[i].
+  //The image x scale jobs are run by waves of nbThreads jobs, each worker having its own scratch buffers,
+  //and are reduced in the scale order so that the result does not depend on the number of threads.
+  template <typename Type>
+  void accumulateLogSurrounds(const std::vector<vpImage<Type> > &images, const std::vector<double> &retinexScales,
+                              const int scaleDiv, const int kernelSize, const vp::vpRetinexBlurMethod &blurMethod,
+                              const int nbThreads, std::vector<vpImage<Type> > &res) {
+    int nbImages = (int) images.size();
+    int size = (int) images[0].getSize();
+
+    std::vector<std::vector<vpImage<Type> > > pyramids(images.size());
+    if (blurMethod == vp::RETINEX_BLUR_PYRAMID) {
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbThreads)
+#endif
+      for (int i = 0; i < nbImages; i++) {
+        buildGaussianPyramid(images[(size_t) i], pyramids[(size_t) i]);
+      }
+    }
+
+    int nbJobs = nbImages * scaleDiv;
+    int nbWorkers = std::max(1, std::min(nbThreads, nbJobs));
+    std::vector<vpRetinexBuffers<Type> > buffers((size_t) nbWorkers);
+
+    res.resize(images.size());
+    for (int i = 0; i < nbImages; i++) {
+      res[(size_t) i].resize(images[(size_t) i].getHeight(), images[(size_t) i].getWidth());
+    }
+
+    for (int firstJob = 0; firstJob < nbJobs; firstJob += nbWorkers) {
+      int nbWaveJobs = std::min(nbWorkers, nbJobs - firstJob);
+
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nbWaveJobs)
+#endif
+      for (int worker = 0; worker < nbWaveJobs; worker++) {
+        int job = firstJob + worker;
+        const vpImage<Type> &I = images[(size_t) (job / scaleDiv)];
+        double sigma = retinexScales[(size_t) (job % scaleDiv)];
+        vpRetinexBuffers<Type> &buffer = buffers[(size_t) worker];
+
+        if (blurMethod == vp::RETINEX_BLUR_RECURSIVE) {
+          recursiveGaussianBlur(I, buffer.blurImage, sigma, buffer.lineBuffer);
+        } else if (blurMethod == vp::RETINEX_BLUR_PYRAMID) {
+          pyramidGaussianBlur(I, pyramids[(size_t) (job / scaleDiv)], buffer.blurImage, sigma, buffer.pyramidBlurImage,
+                              buffer.lineBuffer);
+        } else {
+          kernelGaussianBlur(I, buffer.blurImage, (unsigned int) kernelSize, sigma, buffer.kernel, buffer.lineBuffer);
+        }
+
+        Type *ptrBlur = buffer.blurImage.bitmap;
+        for (int cpt = 0; cpt < size; cpt++) {
+          ptrBlur[cpt] = std::log(ptrBlur[cpt]);
+        }
+      }
+
+      //Reduction in the job order
+      for (int worker = 0; worker < nbWaveJobs; worker++) {
+        int job = firstJob + worker;
+        Type *ptrRes = res[(size_t) (job / scaleDiv)].bitmap;
+        const Type *ptrLog = buffers[(size_t) worker].blurImage.bitmap;
+
+        if (job % scaleDiv == 0) {
+          memcpy(ptrRes, ptrLog, (size_t) size * sizeof(Type));
+        } else {
+#if defined VISP_HAVE_OPENMP
+#pragma omp parallel for num_threads(nbWorkers)
+#endif
+          for (int cpt = 0; cpt < size; cpt++) {
+            ptrRes[cpt] += ptrLog[cpt];
+          }
+        }
+      }
+    }
+  }
+
+  //Statistics of the output values, updated while they are computed
+  struct vpRetinexOutputStatistics {
+    unsigned int count;
+    double mean, m2;
+    double minValue, maxValue;
+
+    vpRetinexOutputStatistics()
+      : count(0), mean(0.0), m2(0.0), minValue(std::numeric_limits<double>::max()),
+        maxValue(-std::numeric_limits<double>::max()) {
+    }
+
+    //Welford's algorithm
+    inline void update(const double value) {
+      count++;
+      double delta = value - mean;
+      mean += delta / count;
+      m2 += delta * (value - mean);
+
+      minValue = std::min(minValue, value);
+      maxValue = std::max(maxValue, value);
+    }
+  };
+
+  //Position, in bins, below which there are nb values
+  double histogramCut(const std::vector<unsigned int> &histogram, const bool fromLow, const double nb) {
+    double cumul = 0.0;
+    size_t nbBins = histogram.size();
+    for (size_t i = 0; i < nbBins; i++) {
+      double value = histogram[fromLow ? i : nbBins-1-i];
+      if (cumul + value > nb) {
+        return i + (nb - cumul) / value;
+      }
+      cumul += value;
+    }
+
+    return (double) nbBins;
+  }
+
+  //Output values in [mini ; mini + range] are mapped to [0 ; 255]. The bounds are mean -/+ dynamic*stdev or,
+  //if clipPercent > 0, the clipPercent and 100 - clipPercent percentiles of the output values estimated with
+  //a histogram (GIMP like clipping).
+  template <typename Type>
+  void computeOutputRange(const std::vector<vpImage<Type> > &outputs, const vpRetinexOutputStatistics &stats,
+                          const double dynamic, const double clipPercent, double &mini, double &range) {
+    double maxi;
+    if (clipPercent > 0.0 && stats.maxValue > stats.minValue) {
+      const int nbBins = 4096;
+      std::vector<unsigned int> histogram((size_t) nbBins, 0);
+      double binScale = nbBins / (stats.maxValue - stats.minValue);
+
+      for (size_t i = 0; i < outputs.size(); i++) {
+        const Type *ptr = outputs[i].bitmap;
+        unsigned int size = outputs[i].getSize();
+        for (unsigned int cpt = 0; cpt < size; cpt++) {
+          int bin = (int) ((ptr[cpt] - stats.minValue) * binScale);
+          histogram[(size_t) std::max(0, std::min(bin, nbBins-1))]++;
+        }
+      }
+
+      double nbClipped = clipPercent / 100.0 * stats.count;
+      mini = stats.minValue + histogramCut(histogram, true, nbClipped) / binScale;
+      maxi = stats.maxValue - histogramCut(histogram, false, nbClipped) / binScale;
+    } else {
+      double stdev = stats.count > 0 ? std::sqrt(stats.m2 / stats.count) : 0.0;
+      mini = stats.mean - dynamic*stdev;
+      maxi = stats.mean + dynamic*stdev;
+    }
+
+    range = maxi - mini;
+    if(vpMath::nul(range)) {
+      range = 1.0;
+    }
+  }
+
+  //The pixel values are integers, log(I+1) and log(R+G+B+3) are tabulated
+  void computeLogTable(std::vector<double> &logTable) {
+    logTable.resize(3*255 + 4);
+    for (size_t i = 1; i < logTable.size(); i++) {
+      logTable[i] = std::log((double) i);
+    }
+  }
+
+  bool checkRetinexParameters(const int scale, const int scaleDiv, const double clipPercent) {
+    //Assert scale
+    if(scale < 16 || scale > 250) {
+      std::cerr << "Scale must be between the interval [16 - 250]" << std::endl;
+      return false;
+    }
+
+    //Assert scaleDiv
+    if(scaleDiv < 1 || scaleDiv > 8) {
+      std::cerr << "Scale division must be between the interval [1 - 8]" << std::endl;
+      return false;
+    }
+
+    //Assert clipPercent
+    if(clipPercent < 0.0 || clipPercent >= 50.0) {
+      std::cerr << "Clip percent must be between the interval [0 - 50[" << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  int computeKernelSize(const unsigned int width, const unsigned int height, const int _kernelSize) {
+    int kernelSize = _kernelSize;
+    if(kernelSize == -1) {
+      //Compute the kernel size from the input image size
+      kernelSize = (int) (std::min(width, height) / 2.0);
+      kernelSize = (kernelSize - kernelSize%2) + 1;
+    }
+
+    return kernelSize;
+  }
+}
+
 
 std::vector<double> retinexScalesDistribution(const int scaleDiv, const int level, const int scale) {
   std::vector<double> scales(MAX_RETINEX_SCALES);
@@ -92,95 +624,149 @@ std::vector<double> retinexScalesDistribution(const int scaleDiv, const int leve
 }
 
 //See: http://imagej.net/Retinex and https://docs.gimp.org/en/plug-in-retinex.html
+template <typename Type>
 void MSRCR(vpImage<vpRGBa> &I, const int _scale, const int scaleDiv,
-    const int level, const double dynamic, const int _kernelSize) {
+    const int level, const double dynamic, const int _kernelSize, const vp::vpRetinexBlurMethod &blurMethod,
+    const int nbThreads, const double clipPercent) {
   //Calculate the scales of filtering according to the number of filter and their distribution.
   std::vector<double> retinexScales = retinexScalesDistribution(scaleDiv, level, _scale);
 
   //Filtering according to the various scales.
   //Summarize the results of the various filters according to a specific weight(here equivalent for all).
   double weight = 1.0 / (double) scaleDiv;
-
-  std::vector<vpImage<double> > doubleRGB(3);
-  std::vector<vpImage<double> > doubleResRGB(3);
   unsigned int size = I.getSize();
+  int kernelSize = computeKernelSize(I.getWidth(), I.getHeight(), _kernelSize);
 
-  int kernelSize = _kernelSize;
-  if(kernelSize == -1) {
-    //Compute the kernel size from the input image size
-    kernelSize = (int) (std::min(I.getWidth(), I.getHeight()) / 2.0);
-    kernelSize = (kernelSize - kernelSize%2) + 1;
-  }
+  std::vector<double> logTable;
+  computeLogTable(logTable);
 
+  std::vector<vpImage<Type> > channelImages(3), resRGB;
   for(int channel = 0; channel < 3; channel++) {
-    doubleRGB[(size_t) channel] = vpImage<double>(I.getHeight(), I.getWidth());
-    doubleResRGB[(size_t) channel] = vpImage<double>(I.getHeight(), I.getWidth());
-
-    for(unsigned int cpt = 0; cpt < size; cpt++) {
-      //Shift the pixel values by 1 to avoid problem with log(0)
-      switch(channel) {
-      case 0:
-        doubleRGB[(size_t) channel].bitmap[cpt] = I.bitmap[cpt].R + 1.0;
-        break;
+    extractChannel(I, channel, channelImages[(size_t) channel]);
+  }
 
-      case 1:
-        doubleRGB[(size_t) channel].bitmap[cpt] = I.bitmap[cpt].G + 1.0;
-        break;
+  accumulateLogSurrounds(channelImages, retinexScales, scaleDiv, kernelSize, blurMethod, nbThreads, resRGB);
 
-      case 2:
-        doubleRGB[(size_t) channel].bitmap[cpt] = I.bitmap[cpt].B + 1.0;
-        break;
+  //In fact one calculates a ratio between the original values and the filtered values.
+  //The result replaces the accumulated surrounds, while the mean and the standard deviation
+  //are updated in the same pass.
+  const double gain = 1.0, alpha = 128.0, offset = 0.0;
+  const double logAlpha = std::log(alpha);
+  vpRetinexOutputStatistics stats;
 
-      default:
-        break;
-      }
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    const vpRGBa &pixel = I.bitmap[cpt];
+    double logl = logTable[(size_t) (pixel.R + pixel.G + pixel.B + 3)];
+    unsigned char values[3] = {pixel.R, pixel.G, pixel.B};
+
+    for (size_t channel = 0; channel < 3; channel++) {
+      double logI = logTable[(size_t) values[channel] + 1];
+      Type &res = resRGB[channel].bitmap[cpt];
+      double dest = gain * (logAlpha + logI - logl) * (logI - weight * res) + offset;
+      res = (Type) dest;
+      stats.update(dest);
     }
+  }
 
-    for (int sc = 0; sc < scaleDiv; sc++) {
-      vpImage<double> blurImage;
-      double sigma = retinexScales[(size_t) sc];
-      vpImageFilter::gaussianBlur(doubleRGB[(size_t) channel], blurImage, (unsigned int) kernelSize, sigma);
+  double mini = 0.0, range = 1.0;
+  computeOutputRange(resRGB, stats, dynamic, clipPercent, mini, range);
 
-      for(unsigned int cpt = 0; cpt < size; cpt++) {
-        //Summarize the filtered values.
-        //In fact one calculates a ratio between the original values and the filtered values.
-        doubleResRGB[(size_t) channel].bitmap[cpt] += weight * (std::log(doubleRGB[(size_t) channel].bitmap[cpt])
-          - std::log(blurImage.bitmap[cpt]));
-      }
-    }
+  const Type *ptrR = resRGB[0].bitmap, *ptrG = resRGB[1].bitmap, *ptrB = resRGB[2].bitmap;
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    I.bitmap[cpt].R = vpMath::saturate<unsigned char>((255.0 * (ptrR[cpt] - mini) / range));
+    I.bitmap[cpt].G = vpMath::saturate<unsigned char>((255.0 * (ptrG[cpt] - mini) / range));
+    I.bitmap[cpt].B = vpMath::saturate<unsigned char>((255.0 * (ptrB[cpt] - mini) / range));
   }
+}
 
-  std::vector<double> dest(size*3);
-  const double gain = 1.0, alpha = 128.0, offset = 0.0;
+//Multiscale retinex without color restoration of a single channel image
+template <typename Type>
+void MSR(vpImage<unsigned char> &I, const int _scale, const int scaleDiv,
+    const int level, const double dynamic, const int _kernelSize, const vp::vpRetinexBlurMethod &blurMethod,
+    const int nbThreads, const double clipPercent) {
+  std::vector<double> retinexScales = retinexScalesDistribution(scaleDiv, level, _scale);
+  double weight = 1.0 / (double) scaleDiv;
+  unsigned int size = I.getSize();
+  int kernelSize = computeKernelSize(I.getWidth(), I.getHeight(), _kernelSize);
 
+  std::vector<double> logTable;
+  computeLogTable(logTable);
+
+  //Shift the pixel values by 1 to avoid problem with log(0)
+  std::vector<vpImage<Type> > Ishift(1, vpImage<Type>(I.getHeight(), I.getWidth())), surrounds;
   for(unsigned int cpt = 0; cpt < size; cpt++) {
-    double logl = std::log( (double) (I.bitmap[cpt].R + I.bitmap[cpt].G + I.bitmap[cpt].B + 3.0) );
+    Ishift[0].bitmap[cpt] = (Type) (I.bitmap[cpt] + 1.0);
+  }
 
-    dest[cpt*3] = gain * (std::log(alpha * doubleRGB[0].bitmap[cpt]) - logl) * doubleResRGB[0].bitmap[cpt] + offset;
-    dest[cpt*3 + 1] = gain * (std::log(alpha * doubleRGB[1].bitmap[cpt]) - logl) * doubleResRGB[1].bitmap[cpt] + offset;
-    dest[cpt*3 + 2] = gain * (std::log(alpha * doubleRGB[2].bitmap[cpt]) - logl) * doubleResRGB[2].bitmap[cpt] + offset;
+  accumulateLogSurrounds(Ishift, retinexScales, scaleDiv, kernelSize, blurMethod, nbThreads, surrounds);
+  vpImage<Type> &res = surrounds[0];
+
+  vpRetinexOutputStatistics stats;
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    double dest = logTable[(size_t) I.bitmap[cpt] + 1] - weight * res.bitmap[cpt];
+    res.bitmap[cpt] = (Type) dest;
+    stats.update(dest);
   }
 
-  double sum = std::accumulate(dest.begin(), dest.end(), 0.0);
-  double mean = sum / dest.size();
+  double mini = 0.0, range = 1.0;
+  computeOutputRange(surrounds, stats, dynamic, clipPercent, mini, range);
+
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    I.bitmap[cpt] = vpMath::saturate<unsigned char>((255.0 * (res.bitmap[cpt] - mini) / range));
+  }
+}
+
+//Multiscale retinex of the intensity (R+G+B)/3, the color channels are scaled by the same factor to
+//preserve the chromaticity. See: Petro A. B., Sbert C. and Morel J.-M. (2014), "Multiscale Retinex",
+//Image Processing On Line 4: 71-88.
+template <typename Type>
+void intensityMSR(vpImage<vpRGBa> &I, const int _scale, const int scaleDiv,
+    const int level, const double dynamic, const int _kernelSize, const vp::vpRetinexBlurMethod &blurMethod,
+    const int nbThreads, const double clipPercent) {
+  std::vector<double> retinexScales = retinexScalesDistribution(scaleDiv, level, _scale);
+  double weight = 1.0 / (double) scaleDiv;
+  unsigned int size = I.getSize();
+  int kernelSize = computeKernelSize(I.getWidth(), I.getHeight(), _kernelSize);
+
+  std::vector<double> logTable;
+  computeLogTable(logTable);
+  const double log3 = std::log(3.0);
 
-  std::vector<double> diff(dest.size());
-  std::transform(dest.begin(), dest.end(), diff.begin(), std::bind2nd(std::minus<double>(), mean));
-  double sq_sum = std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
-  double stdev = std::sqrt(sq_sum / dest.size());
+  //Intensity shifted by 1 to avoid problem with log(0)
+  std::vector<vpImage<Type> > intensity(1, vpImage<Type>(I.getHeight(), I.getWidth())), surrounds;
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    intensity[0].bitmap[cpt] = (Type) ((I.bitmap[cpt].R + I.bitmap[cpt].G + I.bitmap[cpt].B + 3.0) / 3.0);
+  }
 
-  double mini = mean - dynamic*stdev;
-  double maxi = mean + dynamic*stdev;
-  double range = maxi - mini;
+  accumulateLogSurrounds(intensity, retinexScales, scaleDiv, kernelSize, blurMethod, nbThreads, surrounds);
+  vpImage<Type> &res = surrounds[0];
 
-  if(vpMath::nul(range)) {
-    range = 1.0;
+  vpRetinexOutputStatistics stats;
+  for(unsigned int cpt = 0; cpt < size; cpt++) {
+    const vpRGBa &pixel = I.bitmap[cpt];
+    double logIntensity = logTable[(size_t) (pixel.R + pixel.G + pixel.B + 3)] - log3;
+    double dest = logIntensity - weight * res.bitmap[cpt];
+    res.bitmap[cpt] = (Type) dest;
+    stats.update(dest);
   }
 
+  double mini = 0.0, range = 1.0;
+  computeOutputRange(surrounds, stats, dynamic, clipPercent, mini, range);
+
   for(unsigned int cpt = 0; cpt < size; cpt++) {
-    I.bitmap[cpt].R = vpMath::saturate<unsigned char>((255.0 * (dest[cpt*3 + 0] - mini) / range));
-    I.bitmap[cpt].G = vpMath::saturate<unsigned char>((255.0 * (dest[cpt*3 + 1] - mini) / range));
-    I.bitmap[cpt].B = vpMath::saturate<unsigned char>((255.0 * (dest[cpt*3 + 2] - mini) / range));
+    vpRGBa &pixel = I.bitmap[cpt];
+    double newIntensity = std::max(0.0, std::min(255.0, 255.0 * (res.bitmap[cpt] - mini) / range));
+    unsigned char maxValue = std::max(pixel.R, std::max(pixel.G, pixel.B));
+
+    if (maxValue == 0) {
+      pixel.R = pixel.G = pixel.B = vpMath::saturate<unsigned char>(newIntensity);
+    } else {
+      //The factor is bounded so that no channel saturates and changes the hue
+      double factor = std::min(3.0 * newIntensity / (pixel.R + pixel.G + pixel.B), 255.0 / maxValue);
+      pixel.R = vpMath::saturate<unsigned char>(pixel.R * factor);
+      pixel.G = vpMath::saturate<unsigned char>(pixel.G * factor);
+      pixel.B = vpMath::saturate<unsigned char>(pixel.B * factor);
+    }
   }
 }
 
@@ -199,18 +785,24 @@ void MSRCR(vpImage<vpRGBa> &I, const int _scale, const int scaleDiv,
     - 2, enhances the bright regions of the image.
   \param dynamic : Adjusts the color of the result. Large values produce less saturated images.
   \param kernelSize : Kernel size for the gaussian blur operation. If -1, the kernel size is calculated from the image size.
+  \param blurMethod : Gaussian blur backend. With vp::RETINEX_BLUR_RECURSIVE, the blur cost no longer depends
+  on the scale and \e kernelSize is ignored. vp::RETINEX_BLUR_PYRAMID also ignores \e kernelSize and blurs each
+  scale at a downsampled level of a Gaussian pyramid shared by all the scales.
+  \param useFloat : If true, the intermediate images are computed in single precision, which divides the memory
+  footprint by two and speeds up the per pixel passes.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The channel and scale blurs are run in parallel, each thread needing its own temporary image.
+  The result does not depend on the number of threads.
+  \param clipPercent : If > 0, the output is stretched between the \e clipPercent and 100 - \e clipPercent
+  percentiles of the Retinex values instead of mean -/+ \e dynamic * standard deviation. The percentiles are
+  estimated with a histogram, which is more robust on images with saturated highlights.
+  \param intensityOnly : If true, the Retinex is applied only on the intensity (R+G+B)/3 and the color channels
+  are scaled by the same factor, which preserves the chromaticity and processes a single channel.
 */
 void vp::retinex(vpImage<vpRGBa> &I, const int scale, const int scaleDiv,
-    const int level, const double dynamic, const int kernelSize) {
-  //Assert scale
-  if(scale < 16 || scale > 250) {
-    std::cerr << "Scale must be between the interval [16 - 250]" << std::endl;
-    return;
-  }
-
-  //Assert scaleDiv
-  if(scaleDiv < 1 || scaleDiv > 8) {
-    std::cerr << "Scale division must be between the interval [1 - 8]" << std::endl;
+    const int level, const double dynamic, const int kernelSize, const vpRetinexBlurMethod &blurMethod,
+    const bool useFloat, const int nbThreads, const double clipPercent, const bool intensityOnly) {
+  if(!checkRetinexParameters(scale, scaleDiv, clipPercent)) {
     return;
   }
 
@@ -218,7 +810,26 @@ void vp::retinex(vpImage<vpRGBa> &I, const int scale, const int scaleDiv,
     return;
   }
 
-  MSRCR(I, scale, scaleDiv, level, dynamic, kernelSize);
+#if defined VISP_HAVE_OPENMP
+  int nbThreads_ = nbThreads > 0 ? nbThreads : omp_get_max_threads();
+#else
+  int nbThreads_ = 1;
+  (void) nbThreads;
+#endif
+
+  if (intensityOnly) {
+    if (useFloat) {
+      intensityMSR<float>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+    } else {
+      intensityMSR<double>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+    }
+  } else {
+    if (useFloat) {
+      MSRCR<float>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+    } else {
+      MSRCR<double>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+    }
+  }
 }
 
 /*!
@@ -237,9 +848,111 @@ void vp::retinex(vpImage<vpRGBa> &I, const int scale, const int scaleDiv,
     - 2, enhances the bright regions of the image.
   \param dynamic : Adjusts the color of the result. Large values produce less saturated images.
   \param kernelSize : Kernel size for the gaussian blur operation. If -1, the kernel size is calculated from the image size.
+  \param blurMethod : Gaussian blur backend. With vp::RETINEX_BLUR_RECURSIVE, the blur cost no longer depends
+  on the scale and \e kernelSize is ignored. vp::RETINEX_BLUR_PYRAMID also ignores \e kernelSize and blurs each
+  scale at a downsampled level of a Gaussian pyramid shared by all the scales.
+  \param useFloat : If true, the intermediate images are computed in single precision, which divides the memory
+  footprint by two and speeds up the per pixel passes.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The channel and scale blurs are run in parallel, each thread needing its own temporary image.
+  The result does not depend on the number of threads.
+  \param clipPercent : If > 0, the output is stretched between the \e clipPercent and 100 - \e clipPercent
+  percentiles of the Retinex values instead of mean -/+ \e dynamic * standard deviation. The percentiles are
+  estimated with a histogram, which is more robust on images with saturated highlights.
+  \param intensityOnly : If true, the Retinex is applied only on the intensity (R+G+B)/3 and the color channels
+  are scaled by the same factor, which preserves the chromaticity and processes a single channel.
 */
 void vp::retinex(const vpImage<vpRGBa> &I1, vpImage<vpRGBa> &I2, const int scale, const int scaleDiv,
-    const int level, const double dynamic, const int kernelSize) {
+    const int level, const double dynamic, const int kernelSize, const vpRetinexBlurMethod &blurMethod,
+    const bool useFloat, const int nbThreads, const double clipPercent, const bool intensityOnly) {
+  I2 = I1;
+  vp::retinex(I2, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, useFloat, nbThreads, clipPercent,
+              intensityOnly);
+}
+
+/*!
+  \ingroup group_imgproc_retinex
+
+  Apply the multiscale Retinex algorithm on a grayscale image (the input image is modified).
+  \param I : The grayscale image after application of the Retinex technique.
+  \param scale : Specifies the depth of the retinex effect. Minimum value is 16, a value providing gross, unrefined filtering.
+  Maximum value is 250. Optimal and default value is 240.
+  \param scaleDiv : Specifies the number of iterations of the multiscale filter.
+  Values larger than 2 exploit the "multiscale" nature of the algorithm.
+  \param level : Specifies distribution of the Gaussian blurring kernel sizes for Scale division values > 2:
+    - 0, tends to treat all image intensities similarly,
+    - 1, enhances dark regions of the image,
+    - 2, enhances the bright regions of the image.
+  \param dynamic : Adjusts the contrast of the result. Large values produce less contrasted images.
+  \param kernelSize : Kernel size for the gaussian blur operation. If -1, the kernel size is calculated from the image size.
+  \param blurMethod : Gaussian blur backend. With vp::RETINEX_BLUR_RECURSIVE, the blur cost no longer depends
+  on the scale and \e kernelSize is ignored. vp::RETINEX_BLUR_PYRAMID also ignores \e kernelSize and blurs each
+  scale at a downsampled level of a Gaussian pyramid shared by all the scales.
+  \param useFloat : If true, the intermediate images are computed in single precision, which divides the memory
+  footprint by two and speeds up the per pixel passes.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The channel and scale blurs are run in parallel, each thread needing its own temporary image.
+  The result does not depend on the number of threads.
+  \param clipPercent : If > 0, the output is stretched between the \e clipPercent and 100 - \e clipPercent
+  percentiles of the Retinex values instead of mean -/+ \e dynamic * standard deviation. The percentiles are
+  estimated with a histogram, which is more robust on images with saturated highlights.
+*/
+void vp::retinex(vpImage<unsigned char> &I, const int scale, const int scaleDiv,
+    const int level, const double dynamic, const int kernelSize, const vpRetinexBlurMethod &blurMethod,
+    const bool useFloat, const int nbThreads, const double clipPercent) {
+  if(!checkRetinexParameters(scale, scaleDiv, clipPercent)) {
+    return;
+  }
+
+  if(I.getWidth()*I.getHeight() == 0) {
+    return;
+  }
+
+#if defined VISP_HAVE_OPENMP
+  int nbThreads_ = nbThreads > 0 ? nbThreads : omp_get_max_threads();
+#else
+  int nbThreads_ = 1;
+  (void) nbThreads;
+#endif
+
+  if (useFloat) {
+    MSR<float>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+  } else {
+    MSR<double>(I, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, nbThreads_, clipPercent);
+  }
+}
+
+/*!
+  \ingroup group_imgproc_retinex
+
+  Apply the multiscale Retinex algorithm on a grayscale image.
+  \param I1 : The input grayscale image.
+  \param I2 : The output grayscale image after application of the Retinex technique.
+  \param scale : Specifies the depth of the retinex effect. Minimum value is 16, a value providing gross, unrefined filtering.
+  Maximum value is 250. Optimal and default value is 240.
+  \param scaleDiv : Specifies the number of iterations of the multiscale filter.
+  Values larger than 2 exploit the "multiscale" nature of the algorithm.
+  \param level : Specifies distribution of the Gaussian blurring kernel sizes for Scale division values > 2:
+    - 0, tends to treat all image intensities similarly,
+    - 1, enhances dark regions of the image,
+    - 2, enhances the bright regions of the image.
+  \param dynamic : Adjusts the contrast of the result. Large values produce less contrasted images.
+  \param kernelSize : Kernel size for the gaussian blur operation. If -1, the kernel size is calculated from the image size.
+  \param blurMethod : Gaussian blur backend. With vp::RETINEX_BLUR_RECURSIVE, the blur cost no longer depends
+  on the scale and \e kernelSize is ignored. vp::RETINEX_BLUR_PYRAMID also ignores \e kernelSize and blurs each
+  scale at a downsampled level of a Gaussian pyramid shared by all the scales.
+  \param useFloat : If true, the intermediate images are computed in single precision, which divides the memory
+  footprint by two and speeds up the per pixel passes.
+  \param nbThreads : Number of threads used when ViSP is built with OpenMP, if <= 0 the default number of OpenMP threads
+  is used. The channel and scale blurs are run in parallel, each thread needing its own temporary image.
+  The result does not depend on the number of threads.
+  \param clipPercent : If > 0, the output is stretched between the \e clipPercent and 100 - \e clipPercent
+  percentiles of the Retinex values instead of mean -/+ \e dynamic * standard deviation. The percentiles are
+  estimated with a histogram, which is more robust on images with saturated highlights.
+*/
+void vp::retinex(const vpImage<unsigned char> &I1, vpImage<unsigned char> &I2, const int scale, const int scaleDiv,
+    const int level, const double dynamic, const int kernelSize, const vpRetinexBlurMethod &blurMethod,
+    const bool useFloat, const int nbThreads, const double clipPercent) {
   I2 = I1;
-  vp::retinex(I2, scale, scaleDiv, level, dynamic, kernelSize);
+  vp::retinex(I2, scale, scaleDiv, level, dynamic, kernelSize, blurMethod, useFloat, nbThreads, clipPercent);
 }
@@ -0,0 +1,333 @@
+/****************************************************************************
+ *
+ * This file is part of the ViSP software.
+ * Copyright (C) 2005 - 2016 by Inria. All rights reserved.
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * ("GPL") version 2 as published by the Free Software Foundation.
+ * See the file LICENSE.txt at the root directory of this source
+ * distribution for additional information about the GNU GPL.
+ *
+ * For using ViSP with software that can not be combined with the GNU
+ * GPL, please contact Inria about acquiring a ViSP Professional
+ * Edition License.
+ *
+ * See http://visp.inria.fr for more information.
+ *
+ * This software was developed at:
+ * Inria Rennes - Bretagne Atlantique
+ * Campus Universitaire de Beaulieu
+ * 35042 Rennes Cedex
+ * France
+ *
+ * If you have questions regarding the use of this file, please contact
+ * Inria at visp@inria.fr
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Description:
+ * Run-length encoded binary image.
+ *
+ * Authors:
+ * Souriya Trinh
+ *
+ *****************************************************************************/
+
+/*!
+  \file vpRunLengthImage.cpp
+  \brief Run-length encoded binary image.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <visp3/imgproc/vpImgproc.h>
+#include <visp3/imgproc/vpRunLengthImage.h>
+
+namespace {
+bool compareRuns(const vp::vpRun &run1, const vp::vpRun &run2) {
+  return run1.m_row < run2.m_row || (run1.m_row == run2.m_row && run1.m_begin < run2.m_begin);
+}
+
+//Label the holes, that is the components of the background that do not touch the image border. The background
+//components are computed with backgroundConnexity. holeLabels[k] is the hole label (from 1 to nbHoles, in raster
+//order) of the run k of background, or 0.
+void labelHoles(const vp::vpRunLengthImage &I, vp::vpRunLengthImage &background, std::vector<int> &holeLabels,
+                int &nbHoles, const vpImageMorphology::vpConnexityType &backgroundConnexity) {
+  I.complement(background);
+
+  int nbComponents = 0;
+  vp::connectedComponents(background, holeLabels, nbComponents, backgroundConnexity);
+
+  const std::vector<vp::vpRun> &runs = background.getRuns();
+  std::vector<bool> touchBorder((size_t) nbComponents + 1, false);
+  for (size_t k = 0; k < runs.size(); k++) {
+    if (runs[k].m_row == 0 || runs[k].m_row == I.getHeight() - 1 || runs[k].m_begin == 0 ||
+        runs[k].m_end == I.getWidth()) {
+      touchBorder[(size_t) holeLabels[k]] = true;
+    }
+  }
+
+  std::vector<int> finalLabels((size_t) nbComponents + 1, 0);
+  nbHoles = 0;
+  for (size_t label = 1; label < finalLabels.size(); label++) {
+    if (!touchBorder[label]) {
+      finalLabels[label] = ++nbHoles;
+    }
+  }
+
+  for (size_t k = 0; k < holeLabels.size(); k++) {
+    holeLabels[k] = finalLabels[(size_t) holeLabels[k]];
+  }
+}
+} //namespace
+
+/*!
+  Default constructor, empty image.
+*/
+vp::vpRunLengthImage::vpRunLengthImage() : m_height(0), m_width(0), m_runs(), m_rowRuns(1, 0) {
+}
+
+/*!
+  Create an image without foreground pixels.
+
+  \param height : Height of the image.
+  \param width : Width of the image.
+*/
+vp::vpRunLengthImage::vpRunLengthImage(const unsigned int height, const unsigned int width) :
+  m_height(height), m_width(width), m_runs(), m_rowRuns((size_t) height + 1, 0) {
+}
+
+/*!
+  Encode a binary image.
+
+  \param I : Input image (0 means background, other values mean foreground).
+*/
+vp::vpRunLengthImage::vpRunLengthImage(const vpImage<unsigned char> &I) :
+  m_height(0), m_width(0), m_runs(), m_rowRuns(1, 0) {
+  init(I);
+}
+
+/*!
+  Compute the image of the background runs.
+
+  \param I : Image whose foreground is the background of the current image.
+*/
+void vp::vpRunLengthImage::complement(vpRunLengthImage &I) const {
+  std::vector<vpRun> runs;
+  runs.reserve(m_runs.size() + m_height);
+
+  for (unsigned int i = 0; i < m_height; i++) {
+    unsigned int begin = 0;
+    for (size_t k = m_rowRuns[i]; k < m_rowRuns[i + 1]; k++) {
+      if (m_runs[k].m_begin > begin) {
+        runs.push_back(vpRun(i, begin, m_runs[k].m_begin));
+      }
+      begin = m_runs[k].m_end;
+    }
+
+    if (begin < m_width) {
+      runs.push_back(vpRun(i, begin, m_width));
+    }
+  }
+
+  I.m_height = m_height;
+  I.m_width = m_width;
+  I.m_runs.swap(runs);
+  I.computeRowRuns();
+}
+
+void vp::vpRunLengthImage::computeRowRuns() {
+  m_rowRuns.assign((size_t) m_height + 1, 0);
+  for (size_t k = 0; k < m_runs.size(); k++) {
+    m_rowRuns[(size_t) m_runs[k].m_row + 1]++;
+  }
+
+  for (size_t i = 1; i < m_rowRuns.size(); i++) {
+    m_rowRuns[i] += m_rowRuns[i - 1];
+  }
+}
+
+/*!
+  Decode the image.
+
+  \param I : Output image.
+  \param foregroundValue : Value of the foreground pixels, the background pixels are set to 0.
+*/
+void vp::vpRunLengthImage::convert(vpImage<unsigned char> &I, const unsigned char foregroundValue) const {
+  I.resize(m_height, m_width);
+  if (I.getSize() == 0) {
+    return;
+  }
+
+  memset(I.bitmap, 0, sizeof(unsigned char) * I.getSize());
+  for (size_t k = 0; k < m_runs.size(); k++) {
+    memset(I[m_runs[k].m_row] + m_runs[k].m_begin, foregroundValue,
+           sizeof(unsigned char) * (m_runs[k].m_end - m_runs[k].m_begin));
+  }
+}
+
+/*!
+  \return The number of foreground pixels.
+*/
+unsigned int vp::vpRunLengthImage::getArea() const {
+  unsigned int area = 0;
+  for (size_t k = 0; k < m_runs.size(); k++) {
+    area += m_runs[k].m_end - m_runs[k].m_begin;
+  }
+
+  return area;
+}
+
+/*!
+  Encode a binary image.
+
+  \param I : Input image (0 means background, other values mean foreground).
+*/
+void vp::vpRunLengthImage::init(const vpImage<unsigned char> &I) {
+  m_height = I.getHeight();
+  m_width = I.getWidth();
+  m_runs.clear();
+
+  for (unsigned int i = 0; i < m_height; i++) {
+    const unsigned char *row = I[i];
+    unsigned int j = 0;
+
+    while (j < m_width) {
+      while (j < m_width && row[j] == 0) {
+        j++;
+      }
+
+      if (j < m_width) {
+        unsigned int begin = j;
+        while (j < m_width && row[j] != 0) {
+          j++;
+        }
+
+        m_runs.push_back(vpRun(i, begin, j));
+      }
+    }
+  }
+
+  computeRowRuns();
+}
+
+/*!
+  Set the image from a list of runs. The runs are sorted, and the overlapping or adjacent runs are merged.
+
+  \param height : Height of the image.
+  \param width : Width of the image.
+  \param runs : Runs of foreground pixels, they must be inside the image.
+*/
+void vp::vpRunLengthImage::init(const unsigned int height, const unsigned int width, const std::vector<vpRun> &runs) {
+  m_height = height;
+  m_width = width;
+  m_runs.clear();
+
+  std::vector<vpRun> sortedRuns = runs;
+  std::sort(sortedRuns.begin(), sortedRuns.end(), compareRuns);
+
+  for (size_t k = 0; k < sortedRuns.size(); k++) {
+    const vpRun &run = sortedRuns[k];
+    if (run.m_row >= height || run.m_end > width) {
+      std::cerr << "Run (" << run.m_row << ", " << run.m_begin << ", " << run.m_end << ") is outside the image"
+                << std::endl;
+      m_runs.clear();
+      break;
+    }
+
+    if (run.m_begin < run.m_end) {
+      if (!m_runs.empty() && m_runs.back().m_row == run.m_row && run.m_begin <= m_runs.back().m_end) {
+        m_runs.back().m_end = std::max(m_runs.back().m_end, run.m_end);
+      } else {
+        m_runs.push_back(run);
+      }
+    }
+  }
+
+  computeRowRuns();
+}
+
+/*!
+  \ingroup group_imgproc_morph
+
+  Fill the holes in a run-length encoded binary image, see vp::fillHoles(vpImage<unsigned char> &).
+
+  \param I : Input binary image.
+  \param connexity : Connexity of the background: the holes are the background pixels that cannot be reached from
+  outside the image.
+*/
+void vp::fillHoles(vpRunLengthImage &I, const vpImageMorphology::vpConnexityType &connexity) {
+  if (I.getNbRuns() == 0) {
+    return;
+  }
+
+  vpRunLengthImage background;
+  std::vector<int> holeLabels;
+  int nbHoles = 0;
+  labelHoles(I, background, holeLabels, nbHoles, connexity);
+
+  if (nbHoles > 0) {
+    std::vector<vpRun> runs = I.getRuns();
+    const std::vector<vpRun> &backgroundRuns = background.getRuns();
+    for (size_t k = 0; k < backgroundRuns.size(); k++) {
+      if (holeLabels[k]) {
+        runs.push_back(backgroundRuns[k]);
+      }
+    }
+
+    I.init(I.getHeight(), I.getWidth(), runs);
+  }
+}
+
+/*!
+  \ingroup group_imgproc_contours
+
+  Compute the starting points of the borders followed by vp::findContours() from the runs, without scanning the
+  pixels.
+
+  \param I : Input binary image.
+  \param outerSeeds : First pixel in raster order of each connected component (outer border start), in the order
+  of the labels of vp::connectedComponents().
+  \param holeSeeds : For each hole, foreground pixel on the left of its first pixel in raster order (hole border
+  start).
+  \param connexity : Connexity of the foreground, the background uses the other connexity.
+*/
+void vp::findContourSeeds(const vpRunLengthImage &I, std::vector<vpImagePoint> &outerSeeds,
+                          std::vector<vpImagePoint> &holeSeeds, const vpImageMorphology::vpConnexityType &connexity) {
+  outerSeeds.clear();
+  holeSeeds.clear();
+  if (I.getNbRuns() == 0) {
+    return;
+  }
+
+  std::vector<int> labels;
+  int nbComponents = 0;
+  vp::connectedComponents(I, labels, nbComponents, connexity);
+
+  //The labels are in raster order, the first run of a component brings a new label
+  const std::vector<vpRun> &runs = I.getRuns();
+  outerSeeds.reserve((size_t) nbComponents);
+  for (size_t k = 0; k < runs.size(); k++) {
+    if (labels[k] > (int) outerSeeds.size()) {
+      outerSeeds.push_back(vpImagePoint(runs[k].m_row, runs[k].m_begin));
+    }
+  }
+
+  vpRunLengthImage background;
+  std::vector<int> holeLabels;
+  int nbHoles = 0;
+  labelHoles(I, background, holeLabels, nbHoles,
+             connexity == vpImageMorphology::CONNEXITY_4 ? vpImageMorphology::CONNEXITY_8 :
+                                                          vpImageMorphology::CONNEXITY_4);
+
+  //A hole does not touch the border, so its first run starts after a foreground pixel
+  const std::vector<vpRun> &backgroundRuns = background.getRuns();
+  holeSeeds.reserve((size_t) nbHoles);
+  for (size_t k = 0; k < backgroundRuns.size(); k++) {
+    if (holeLabels[k] > (int) holeSeeds.size()) {
+      holeSeeds.push_back(vpImagePoint(backgroundRuns[k].m_row, backgroundRuns[k].m_begin - 1));
+    }
+  }
+}
@@ -61,7 +61,7 @@ bool isBimodal(const std::vector<float> &hist_float) {
   return (modes == 2);
 }
 
-int computeThresholdHuang(const vpHistogram &hist) {
+int computeThresholdHuang(const std::vector<unsigned int> &hist) {
   //Code ported from the AutoThreshold ImageJ plugin:
   // Implements Huang's fuzzy thresholding method
   // Uses Shannon's entropy function (one can also use Yager's entropy function)
@@ -71,11 +71,11 @@ int computeThresholdHuang(const vpHistogram &hist) {
 
   //Find first and last non-empty bin
   size_t first, last;
-  for (first = 0; first < (size_t) hist.getSize() && hist[first] == 0; first++) {
+  for (first = 0; first < (size_t) hist.size() && hist[first] == 0; first++) {
     // do nothing
   }
 
-  for (last = (size_t) hist.getSize()-1; last > first && hist[last] == 0; last--) {
+  for (last = (size_t) hist.size()-1; last > first && hist[last] == 0; last--) {
     // do nothing
   }
 
@@ -128,8 +128,8 @@ int computeThresholdHuang(const vpHistogram &hist) {
   return bestThreshold;
 }
 
-int computeThresholdIntermodes(const vpHistogram &hist) {
-  if (hist.getSize() < 3) {
+int computeThresholdIntermodes(const std::vector<unsigned int> &hist) {
+  if (hist.size() < 3) {
     return -1;
   }
 
@@ -148,8 +148,8 @@ int computeThresholdIntermodes(const vpHistogram &hist) {
   // Images with histograms having extremely unequal peaks or a broad and
   // ﬂat valley are unsuitable for this method.
 
-  std::vector<float> hist_float(hist.getSize());
-  for (unsigned int cpt = 0; cpt < hist.getSize(); cpt++) {
+  std::vector<float> hist_float(hist.size());
+  for (unsigned int cpt = 0; cpt < hist.size(); cpt++) {
     hist_float[cpt] = hist[cpt];
   }
 
@@ -186,20 +186,20 @@ int computeThresholdIntermodes(const vpHistogram &hist) {
   return std::floor(tt / 2.0); //vpMath::round(tt / 2.0);
 }
 
-int computeThresholdIsoData(const vpHistogram &hist, const unsigned int imageSize) {
+int computeThresholdIsoData(const std::vector<unsigned int> &hist, const unsigned int imageSize) {
   int threshold = 0;
 
   //Code based on BSD Matlab isodata implementation by zephyr
   //STEP 1: Compute mean intensity of image from histogram, set T=mean(I)
-  std::vector<float> cumsum(hist.getSize(), 0.0f);
-  std::vector<float> sum_ip(hist.getSize(), 0.0f);
+  std::vector<float> cumsum(hist.size(), 0.0f);
+  std::vector<float> sum_ip(hist.size(), 0.0f);
   cumsum[0] = hist[0];
-  for (unsigned int cpt = 1; cpt < hist.getSize(); cpt++) {
+  for (unsigned int cpt = 1; cpt < hist.size(); cpt++) {
     sum_ip[cpt] = cpt * (float) hist[cpt] + sum_ip[cpt-1];
     cumsum[cpt] = (float) hist[cpt] + cumsum[cpt-1];
   }
 
-  int T = vpMath::round(sum_ip[255] / imageSize);
+  int T = vpMath::round(sum_ip.back() / imageSize);
 
   //STEP 2: compute Mean above T (MAT) and Mean below T (MBT) using T from
   float MBT = sum_ip[ (size_t) (T-2) ] / cumsum[ (size_t) (T-2) ];
@@ -220,25 +220,25 @@ int computeThresholdIsoData(const vpHistogram &hist, const unsigned int imageSiz
   return threshold;
 }
 
-int computeThresholdMean(const vpHistogram &hist, const unsigned int imageSize) {
+int computeThresholdMean(const std::vector<unsigned int> &hist, const unsigned int imageSize) {
   // C. A. Glasbey, "An analysis of histogram-based thresholding algorithms,"
   // CVGIP: Graphical Models and Image Processing, vol. 55, pp. 532-537, 1993.
   // The threshold is the mean of the greyscale data
   float sum_ip = 0.0f;
-  for (unsigned int cpt = 0; cpt < hist.getSize(); cpt++) {
+  for (unsigned int cpt = 0; cpt < hist.size(); cpt++) {
     sum_ip += cpt * (float) hist[cpt];
   }
 
   return std::floor( sum_ip / imageSize );
 }
 
-int computeThresholdOtsu(const vpHistogram &hist, const unsigned int imageSize) {
+int computeThresholdOtsu(const std::vector<unsigned int> &hist, const unsigned int imageSize) {
   //Otsu, N (1979), "A threshold selection method from gray-level histograms",
   //IEEE Trans. Sys., Man., Cyber. 9: 62-66, doi:10.1109/TSMC.1979.4310076
 
   float mu_T = 0.0f;
-  float sum_ip_all[256];
-  for (int cpt = 0; cpt < (int) hist.getSize(); cpt++) {
+  std::vector<float> sum_ip_all(hist.size());
+  for (int cpt = 0; cpt < (int) hist.size(); cpt++) {
     mu_T += cpt * (float) hist[cpt];
     sum_ip_all[cpt] = mu_T;
   }
@@ -249,7 +249,7 @@ int computeThresholdOtsu(const vpHistogram &hist, const unsigned int imageSize)
   float max_sigma_b = 0.0f;
   int threshold = 0;
 
-  for (int cpt = 0; cpt < 256; cpt++) {
+  for (int cpt = 0; cpt < (int) hist.size(); cpt++) {
     w_B += hist[cpt];
     if (vpMath::nul(w_B, std::numeric_limits<float>::epsilon())) {
       continue;
@@ -275,7 +275,7 @@ int computeThresholdOtsu(const vpHistogram &hist, const unsigned int imageSize)
   return threshold;
 }
 
-int computeThresholdTriangle(vpHistogram &hist) {
+int computeThresholdTriangle(std::vector<unsigned int> &hist) {
   int threshold = 0;
 
   // Zack, G. W., Rogers, W. E. and Latt, S. A., 1977,
@@ -284,13 +284,13 @@ int computeThresholdTriangle(vpHistogram &hist) {
 
   int left_bound = -1, right_bound = -1, max_idx = -1, max_value = 0;
   //Find max value index and left / right most index
-  for (int cpt = 0; cpt < (int) hist.getSize(); cpt++) {
+  for (int cpt = 0; cpt < (int) hist.size(); cpt++) {
     if (left_bound == -1 && hist[cpt] > 0) {
       left_bound = (int) cpt;
     }
 
-    if (right_bound == -1 && hist[(int) hist.getSize()-1-cpt] > 0) {
-      right_bound = (int) hist.getSize()-1-cpt;
+    if (right_bound == -1 && hist[(int) hist.size()-1-cpt] > 0) {
+      right_bound = (int) hist.size()-1-cpt;
     }
 
     if ((int) hist[cpt] > max_value) {
@@ -301,7 +301,7 @@ int computeThresholdTriangle(vpHistogram &hist) {
 
   //First / last index when hist(cpt) == 0
   left_bound = left_bound > 0 ? left_bound-1 : left_bound;
-  right_bound = right_bound < (int) hist.getSize()-1 ? right_bound+1 : right_bound;
+  right_bound = right_bound < (int) hist.size()-1 ? right_bound+1 : right_bound;
 
   //Use the largest bound
   bool flip = false;
@@ -309,15 +309,15 @@ int computeThresholdTriangle(vpHistogram &hist) {
     //Flip histogram to get the largest bound to the left
     flip = true;
 
-    int cpt_left = 0, cpt_right = (int) hist.getSize() - 1;
+    int cpt_left = 0, cpt_right = (int) hist.size() - 1;
     for(; cpt_left < cpt_right; cpt_left++, cpt_right-- ) {
       unsigned int temp = hist[cpt_left];
-      hist.set(cpt_left, hist[cpt_right]);
-      hist.set(cpt_right, temp);
+      hist[(size_t) cpt_left] = hist[(size_t) cpt_right];
+      hist[(size_t) cpt_right] = temp;
     }
 
-    left_bound = (int) hist.getSize() - 1 - right_bound;
-    max_idx = (int) hist.getSize() - 1 - max_idx;
+    left_bound = (int) hist.size() - 1 - right_bound;
+    max_idx = (int) hist.size() - 1 - max_idx;
   }
 
   //Distance from a point to a line defined by two points:
@@ -340,7 +340,51 @@ int computeThresholdTriangle(vpHistogram &hist) {
   threshold--;
 
   if (flip) {
-    threshold = (int) hist.getSize() - 1 - threshold;
+    threshold = (int) hist.size() - 1 - threshold;
+  }
+
+  return threshold;
+}
+
+//Sum the bins of a histogram by groups of factor bins
+void rebinHistogram(const std::vector<unsigned int> &hist, const size_t factor, std::vector<unsigned int> &rebinned) {
+  rebinned.assign((hist.size() + factor - 1) / factor, 0);
+  for (size_t i = 0; i < hist.size(); i++) {
+    rebinned[i / factor] += hist[i];
+  }
+}
+
+int computeThreshold(std::vector<unsigned int> &hist, const vp::vpAutoThresholdMethod &method,
+                     const unsigned int imageSize) {
+  int threshold = -1;
+
+  switch (method) {
+    case vp::AUTO_THRESHOLD_HUANG:
+      threshold = computeThresholdHuang(hist);
+      break;
+
+    case vp::AUTO_THRESHOLD_INTERMODES:
+      threshold = computeThresholdIntermodes(hist);
+      break;
+
+    case vp::AUTO_THRESHOLD_ISODATA:
+      threshold = computeThresholdIsoData(hist, imageSize);
+      break;
+
+    case vp::AUTO_THRESHOLD_MEAN:
+      threshold = computeThresholdMean(hist, imageSize);
+      break;
+
+    case vp::AUTO_THRESHOLD_OTSU:
+      threshold = computeThresholdOtsu(hist, imageSize);
+      break;
+
+    case vp::AUTO_THRESHOLD_TRIANGLE:
+      threshold = computeThresholdTriangle(hist);
+      break;
+
+    default:
+      break;
   }
 
   return threshold;
@@ -365,40 +409,71 @@ unsigned char vp::autoThreshold(vpImage<unsigned char> &I, const vpAutoThreshold
 
   //Compute image histogram
   vpHistogram histogram(I);
-  int threshold = -1;
+  std::vector<unsigned int> hist(histogram.getSize());
+  for (unsigned int cpt = 0; cpt < histogram.getSize(); cpt++) {
+    hist[cpt] = histogram[cpt];
+  }
 
-  switch (method) {
-    case AUTO_THRESHOLD_HUANG:
-      threshold = computeThresholdHuang(histogram);
-      break;
+  int threshold = computeThreshold(hist, method, I.getSize());
 
-    case AUTO_THRESHOLD_INTERMODES:
-      threshold = computeThresholdIntermodes(histogram);
-      break;
+  if (threshold != -1) {
+    //Threshold
+    vpImageTools::binarise(I, (unsigned char) threshold, (unsigned char) 255, backgroundValue, foregroundValue, foregroundValue);
+  }
 
-    case AUTO_THRESHOLD_ISODATA:
-      threshold = computeThresholdIsoData(histogram, I.getSize());
-      break;
+  return threshold;
+}
 
-    case AUTO_THRESHOLD_MEAN:
-      threshold = computeThresholdMean(histogram, I.getSize());
-      break;
+/*!
+  \ingroup group_imgproc_threshold
 
-    case AUTO_THRESHOLD_OTSU:
-      threshold = computeThresholdOtsu(histogram, I.getSize());
-      break;
+  Automatic thresholding of a 16-bit image. The histogram has one bin per value and is stored only up to the
+  maximum value of the image, so 12-bit data stored in 16-bit images use a 4096 bins histogram. Huang and Intermodes
+  methods use a histogram of at most 4096 bins, with groups of values for larger ranges. If no threshold is found
+  (Intermodes method without a bimodal histogram), the image is not modified.
 
-    case AUTO_THRESHOLD_TRIANGLE:
-      threshold = computeThresholdTriangle(histogram);
-      break;
+  \param I : Input 16-bit grayscale image.
+  \param method : Automatic thresholding method.
+  \param backgroundValue : Value to set to the background.
+  \param foregroundValue : Value to set to the foreground.
+  \return The threshold, or -1 if no threshold is found.
+*/
+int vp::autoThreshold(vpImage<unsigned short> &I, const vpAutoThresholdMethod &method,
+                      const unsigned short backgroundValue, const unsigned short foregroundValue) {
+  if (I.getSize() == 0) {
+    return 0;
+  }
 
-    default:
-      break;
+  //Compute image histogram
+  unsigned short maxValue = 0;
+  for (unsigned int i = 0; i < I.getSize(); i++) {
+    maxValue = std::max(maxValue, I.bitmap[i]);
   }
 
+  //At least 3 bins as for 8-bit images, see computeThresholdIntermodes()
+  std::vector<unsigned int> hist(std::max((size_t) maxValue + 1, (size_t) 3), 0);
+  for (unsigned int i = 0; i < I.getSize(); i++) {
+    hist[I.bitmap[i]]++;
+  }
+
+  //Huang is quadratic in the number of bins and Intermodes smooths the histogram until it is bimodal, both are
+  //computed on a histogram of at most 4096 bins, the threshold being the first value of the selected bin
+  size_t factor = 1;
+  if ((method == vp::AUTO_THRESHOLD_HUANG || method == vp::AUTO_THRESHOLD_INTERMODES) && hist.size() > 4096) {
+    factor = (hist.size() + 4095) / 4096;
+    std::vector<unsigned int> rebinned;
+    rebinHistogram(hist, factor, rebinned);
+    hist.swap(rebinned);
+  }
+
+  int threshold = computeThreshold(hist, method, I.getSize());
+
   if (threshold != -1) {
+    threshold *= (int) factor;
+
     //Threshold
-    vpImageTools::binarise(I, (unsigned char) threshold, (unsigned char) 255, backgroundValue, foregroundValue, foregroundValue);
+    vpImageTools::binarise(I, (unsigned short) threshold, (unsigned short) 65535, backgroundValue, foregroundValue,
+                           foregroundValue);
   }
 
   return threshold;
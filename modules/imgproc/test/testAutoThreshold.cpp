@@ -306,6 +306,65 @@ main(int argc, const char ** argv)
     std::cout << "Write: " << filename << std::endl;
 
 
+    //Otsu on 16-bit image, must give the same threshold than on the 8-bit image
+    I_thresh = I;
+    double threshold_8bit = vp::autoThreshold(I_thresh, vp::AUTO_THRESHOLD_OTSU);
+    vpImage<unsigned short> I_thresh_16bit(I.getHeight(), I.getWidth());
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      I_thresh_16bit.bitmap[i] = I.bitmap[i];
+    }
+    t = vpTime::measureTimeMs();
+    threshold = vp::autoThreshold(I_thresh_16bit, vp::AUTO_THRESHOLD_OTSU);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\nAutomatic thresholding (Otsu, 16-bit): " << threshold << " ; t=" << t << " ms" << std::endl;
+
+    if (!vpMath::equal(threshold, threshold_8bit)) {
+      throw vpException(vpException::fatalError, "16-bit Otsu threshold is different from the 8-bit threshold!");
+    }
+
+    //Huang on 16-bit image, must give the same threshold than on the 8-bit image
+    I_thresh = I;
+    threshold_8bit = vp::autoThreshold(I_thresh, vp::AUTO_THRESHOLD_HUANG);
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      I_thresh_16bit.bitmap[i] = I.bitmap[i];
+    }
+    threshold = vp::autoThreshold(I_thresh_16bit, vp::AUTO_THRESHOLD_HUANG);
+    if (!vpMath::equal(threshold, threshold_8bit)) {
+      throw vpException(vpException::fatalError, "16-bit Huang threshold is different from the 8-bit threshold!");
+    }
+
+    //Huang and Intermodes on a full range 16-bit bimodal image, the threshold must be between the two modes
+    vpImage<unsigned short> I_bimodal_16bit(240, 320);
+    for (unsigned int i = 0; i < I_bimodal_16bit.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_bimodal_16bit.getWidth(); j++) {
+        unsigned int noise = (i*7919 + j*104729) % 3001 + (i*j*31 + j*13 + i*977) % 3001;
+        I_bimodal_16bit[i][j] = (unsigned short) ((j < I_bimodal_16bit.getWidth()/2 ? 15000 : 45000) + noise - 3000);
+      }
+    }
+
+    vp::vpAutoThresholdMethod methods_16bit[2] = {vp::AUTO_THRESHOLD_HUANG, vp::AUTO_THRESHOLD_INTERMODES};
+    for (int i = 0; i < 2; i++) {
+      I_thresh_16bit = I_bimodal_16bit;
+      t = vpTime::measureTimeMs();
+      threshold = vp::autoThreshold(I_thresh_16bit, methods_16bit[i]);
+      t = vpTime::measureTimeMs() - t;
+      std::cout << "Automatic thresholding (" << (i == 0 ? "Huang" : "Intermodes") << ", full range 16-bit): "
+                << threshold << " ; t=" << t << " ms" << std::endl;
+
+      if (threshold <= 15000 || threshold >= 45000) {
+        throw vpException(vpException::fatalError, "16-bit threshold is not between the two modes!");
+      }
+    }
+
+    //Intermodes on a constant 16-bit image, no threshold is found and the image is not modified
+    vpImage<unsigned short> I_constant_16bit(60, 80, 30000);
+    I_thresh_16bit = I_constant_16bit;
+    threshold = vp::autoThreshold(I_thresh_16bit, vp::AUTO_THRESHOLD_INTERMODES);
+    if (!vpMath::equal(threshold, -1.0) || I_thresh_16bit != I_constant_16bit) {
+      throw vpException(vpException::fatalError, "16-bit threshold found on a constant image!");
+    }
+
+
     return EXIT_SUCCESS;
   }
   catch(vpException &e) {
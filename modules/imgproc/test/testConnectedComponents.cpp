@@ -34,6 +34,7 @@
  * Souriya Trinh
  *
  *****************************************************************************/
+#include <algorithm>
 #include <map>
 #include <set>
 #include <visp3/core/vpIoTools.h>
@@ -55,6 +56,7 @@
 void usage(const char *name, const char *badparam, std::string ipath, std::string opath, std::string user);
 bool getOptions(int argc, const char **argv, std::string &ipath, std::string &opath, std::string user);
 bool checkLabels(const vpImage<int> &label1, const vpImage<int> &label2);
+bool checkRasterOrder(const vpImage<int> &labels, const int nbComponents);
 
 /*
   Print the program options.
@@ -185,6 +187,27 @@ bool checkLabels(const vpImage<int> &label1, const vpImage<int> &label2) {
   return true;
 }
 
+bool checkRasterOrder(const vpImage<int> &labels, const int nbComponents) {
+  //Labels must be numbered from 1 to nbComponents in the raster order of the first pixel of each component
+  int max_label = 0;
+  for (unsigned int cpt = 0; cpt < labels.getSize(); cpt++) {
+    if (labels.bitmap[cpt] > max_label + 1 || labels.bitmap[cpt] < 0) {
+      std::cerr << "labels.bitmap[cpt] > max_label + 1 || labels.bitmap[cpt] < 0" << std::endl;
+      return false;
+    }
+
+    if (labels.bitmap[cpt] > max_label)
+      max_label = labels.bitmap[cpt];
+  }
+
+  if (max_label != nbComponents) {
+    std::cerr << "max_label != nbComponents" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
 int
 main(int argc, const char ** argv)
 {
@@ -289,6 +312,9 @@ main(int argc, const char ** argv)
     std::cout << "\n4-connexity connected components:" << std::endl;
     std::cout << "Time: " << t << " ms" << std::endl;
     std::cout << "nbComponents=" << nbComponents << std::endl;
+    if (!checkRasterOrder(labels_connex4, nbComponents)) {
+      throw vpException(vpException::fatalError, "labels_connex4 are not in raster order");
+    }
 
     vpImage<int> labels_connex8;
     t = vpTime::measureTimeMs();
@@ -297,6 +323,190 @@ main(int argc, const char ** argv)
     std::cout << "\n8-connexity connected components:" << std::endl;
     std::cout << "Time: " << t << " ms" << std::endl;
     std::cout << "nbComponents=" << nbComponents << std::endl;
+    if (!checkRasterOrder(labels_connex8, nbComponents)) {
+      throw vpException(vpException::fatalError, "labels_connex8 are not in raster order");
+    }
+
+    //Multithreaded labeling by strips must give the same labels
+    vpImage<int> labels_connex4_mt, labels_connex8_mt;
+    int nbComponents_mt = 0;
+    t = vpTime::measureTimeMs();
+    vp::connectedComponents(I, labels_connex4_mt, nbComponents_mt, vpImageMorphology::CONNEXITY_4, 0);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\n4-connexity connected components (multithreaded):" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+    if (!(labels_connex4_mt == labels_connex4)) {
+      throw vpException(vpException::fatalError, "(labels_connex4_mt != labels_connex4)");
+    }
+
+    t = vpTime::measureTimeMs();
+    vp::connectedComponents(I, labels_connex8_mt, nbComponents_mt, vpImageMorphology::CONNEXITY_8, 0);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\n8-connexity connected components (multithreaded):" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+    if (!(labels_connex8_mt == labels_connex8) || nbComponents_mt != nbComponents) {
+      throw vpException(vpException::fatalError, "(labels_connex8_mt != labels_connex8)");
+    }
+
+    //Statistics computed during the labeling must match the statistics computed from the labels
+    vpImage<int> labels_stats;
+    vp::vpConnectedComponentsStats stats;
+    int nbComponents_stats = 0;
+    t = vpTime::measureTimeMs();
+    vp::connectedComponentsWithStats(I, labels_stats, nbComponents_stats, stats, vpImageMorphology::CONNEXITY_8, true);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\n8-connexity connected components with statistics:" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+    if (!(labels_stats == labels_connex8) || nbComponents_stats != nbComponents) {
+      throw vpException(vpException::fatalError, "(labels_stats != labels_connex8)");
+    }
+
+    std::vector<unsigned int> area((size_t) nbComponents, 0);
+    std::vector<double> sum_i((size_t) nbComponents, 0.0), sum_jj((size_t) nbComponents, 0.0);
+    std::vector<unsigned int> bottom((size_t) nbComponents, 0), right((size_t) nbComponents, 0);
+    for (unsigned int i = 0; i < labels_connex8.getHeight(); i++) {
+      for (unsigned int j = 0; j < labels_connex8.getWidth(); j++) {
+        if (labels_connex8[i][j]) {
+          size_t k = (size_t) labels_connex8[i][j] - 1;
+          area[k]++;
+          sum_i[k] += i;
+          sum_jj[k] += (double) j * j;
+          bottom[k] = std::max(bottom[k], i);
+          right[k] = std::max(right[k], j);
+        }
+      }
+    }
+
+    for (size_t k = 0; k < (size_t) nbComponents; k++) {
+      if (area[k] != stats.m_area[k] || sum_i[k] != stats.m_sumI[k] || sum_jj[k] != stats.m_sumJJ[k] ||
+          bottom[k] != stats.m_bottom[k] || right[k] != stats.m_right[k]) {
+        throw vpException(vpException::fatalError, "Wrong statistics for component %d", (int) k + 1);
+      }
+    }
+
+    //Small components are discarded
+    unsigned int min_area = 20;
+    vp::connectedComponentsWithStats(I, labels_stats, nbComponents_stats, stats, vpImageMorphology::CONNEXITY_8, false,
+                                     min_area);
+    int nbComponents_min_area = 0;
+    for (size_t k = 0; k < (size_t) nbComponents; k++) {
+      if (area[k] >= min_area) {
+        nbComponents_min_area++;
+      }
+    }
+    std::cout << "nbComponents with an area >= " << min_area << ": " << nbComponents_stats << std::endl;
+    if (nbComponents_stats != nbComponents_min_area || !checkRasterOrder(labels_stats, nbComponents_stats)) {
+      throw vpException(vpException::fatalError, "Wrong labeling with a minimal area");
+    }
+
+    //Multi-valued labeling: the background is labeled too
+    vpImage<int> labels_multi;
+    int nbComponents_multi = 0;
+    t = vpTime::measureTimeMs();
+    vp::connectedComponentsMultiValued(I, labels_multi, nbComponents_multi, 0, vpImageMorphology::CONNEXITY_8);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\n8-connexity multi-valued connected components:" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+    std::cout << "nbComponents=" << nbComponents_multi << std::endl;
+
+    vpImage<unsigned char> I_complement(I.getHeight(), I.getWidth());
+    for (unsigned int cpt = 0; cpt < I.getSize(); cpt++) {
+      I_complement.bitmap[cpt] = I.bitmap[cpt] ? 0 : 255;
+    }
+    vpImage<int> labels_complement;
+    int nbComponents_complement = 0;
+    vp::connectedComponents(I_complement, labels_complement, nbComponents_complement, vpImageMorphology::CONNEXITY_8);
+    if (nbComponents_multi != nbComponents + nbComponents_complement || !checkRasterOrder(labels_multi, nbComponents_multi)) {
+      throw vpException(vpException::fatalError, "Wrong multi-valued labeling");
+    }
+
+    vp::connectedComponentsMultiValued(I, labels_multi, nbComponents_multi, 255, vpImageMorphology::CONNEXITY_4, 0);
+    if (nbComponents_multi != 1) {
+      throw vpException(vpException::fatalError, "Wrong multi-valued labeling with the maximal tolerance");
+    }
+
+    //Run-length encoded image
+    t = vpTime::measureTimeMs();
+    vp::vpRunLengthImage I_rle(I);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\nRun-length encoding: " << I_rle.getNbRuns() << " runs" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+
+    vpImage<unsigned char> I_decoded;
+    I_rle.convert(I_decoded);
+    if (!(I_decoded == I)) {
+      throw vpException(vpException::fatalError, "(I_decoded != I)");
+    }
+
+    std::vector<int> run_labels;
+    int nbComponents_rle = 0;
+    t = vpTime::measureTimeMs();
+    vp::connectedComponents(I_rle, run_labels, nbComponents_rle, vpImageMorphology::CONNEXITY_8);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "\n8-connexity connected components (run-length encoded):" << std::endl;
+    std::cout << "Time: " << t << " ms" << std::endl;
+    if (nbComponents_rle != nbComponents) {
+      throw vpException(vpException::fatalError, "(nbComponents_rle != nbComponents)");
+    }
+
+    const std::vector<vp::vpRun> &runs = I_rle.getRuns();
+    for (size_t k = 0; k < runs.size(); k++) {
+      for (unsigned int j = runs[k].m_begin; j < runs[k].m_end; j++) {
+        if (labels_connex8[runs[k].m_row][j] != run_labels[k]) {
+          throw vpException(vpException::fatalError, "(run_labels != labels_connex8)");
+        }
+      }
+    }
+
+    std::vector<vpImagePoint> outer_seeds, hole_seeds;
+    vp::findContourSeeds(I_rle, outer_seeds, hole_seeds, vpImageMorphology::CONNEXITY_8);
+    std::cout << "Contour seeds: " << outer_seeds.size() << " outer borders, " << hole_seeds.size() << " holes" << std::endl;
+    for (size_t k = 0; k < outer_seeds.size(); k++) {
+      unsigned int i = (unsigned int) outer_seeds[k].get_i(), j = (unsigned int) outer_seeds[k].get_j();
+      if (labels_connex8[i][j] != (int) k + 1 || (j > 0 && labels_connex8[i][j-1] == (int) k + 1)) {
+        throw vpException(vpException::fatalError, "Wrong outer seed for component %d", (int) k + 1);
+      }
+    }
+
+    vpImage<unsigned char> I_fill = I;
+    vp::fillHoles(I_fill);
+    vp::fillHoles(I_rle);
+    I_rle.convert(I_decoded);
+    if (!(I_decoded == I_fill)) {
+      throw vpException(vpException::fatalError, "Run-length encoded fillHoles differs from fillHoles");
+    }
+
+    //With an 8-connected background, the holes are a subset of the 4-connected ones
+    vpImage<unsigned char> I_fill_connex8 = I;
+    vp::fillHoles(I_fill_connex8, vpImageMorphology::CONNEXITY_8);
+    I_rle.init(I);
+    vp::fillHoles(I_rle, vpImageMorphology::CONNEXITY_8);
+    I_rle.convert(I_decoded);
+    if (!(I_decoded == I_fill_connex8)) {
+      throw vpException(vpException::fatalError, "Run-length encoded fillHoles differs from fillHoles (8-connexity)");
+    }
+    for (unsigned int cpt = 0; cpt < I.getSize(); cpt++) {
+      if (I_fill_connex8.bitmap[cpt] > I_fill.bitmap[cpt]) {
+        throw vpException(vpException::fatalError, "Problem with fillHoles and 8-connexity");
+      }
+    }
+
+    //The foreground values are saturated to 255, as the holes
+    vpImage<unsigned char> I_ring(10, 10, 0);
+    for (unsigned int i = 2; i < 8; i++) {
+      for (unsigned int j = 2; j < 8; j++) {
+        I_ring[i][j] = (i == 2 || i == 7 || j == 2 || j == 7) ? 100 : 0;
+      }
+    }
+    vp::fillHoles(I_ring);
+    for (unsigned int i = 0; i < I_ring.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_ring.getWidth(); j++) {
+        bool inside = i >= 2 && i < 8 && j >= 2 && j < 8;
+        if (I_ring[i][j] != (inside ? 255 : 0)) {
+          throw vpException(vpException::fatalError, "Problem with fillHoles on a non binary image");
+        }
+      }
+    }
 
 
     //Save results
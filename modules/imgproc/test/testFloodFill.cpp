@@ -35,6 +35,7 @@
  *
  *****************************************************************************/
 
+#include <algorithm>
 #include <iomanip>
 
 #include <visp3/core/vpIoTools.h>
@@ -310,6 +311,76 @@ main(int argc, const char ** argv)
     }
     std::cout << "\n(I_test_flood_fill_8_connexity == I_check_8_connexity)? " << (I_test_flood_fill_8_connexity == I_check_8_connexity) << std::endl;
 
+    //Test flood fill along a diagonal staircase, connected only with 8-connexity
+    vpImage<unsigned char> I_staircase(6, 6, 255);
+    for (unsigned int i = 0; i < I_staircase.getHeight(); i++) {
+      I_staircase[i][i] = 0;
+      I_staircase[i][I_staircase.getWidth()-1-i] = 0;
+    }
+    vpImage<unsigned char> I_staircase_4_connexity = I_staircase, I_staircase_8_connexity = I_staircase;
+    vp::floodFill(I_staircase_4_connexity, vpImagePoint(0,0), 0, 1, vpImageMorphology::CONNEXITY_4);
+    vp::floodFill(I_staircase_8_connexity, vpImagePoint(5,0), 0, 1, vpImageMorphology::CONNEXITY_8);
+    for (unsigned int cpt = 0; cpt < I_staircase.getSize(); cpt++) {
+      bool filled_4_connexity = cpt == 0;
+      bool filled_8_connexity = I_staircase.bitmap[cpt] == 0;
+      if ((I_staircase_4_connexity.bitmap[cpt] == 1) != filled_4_connexity ||
+          (I_staircase_8_connexity.bitmap[cpt] == 1) != filled_8_connexity) {
+        throw vpException(vpException::fatalError, "Problem with vp::floodFill() on the diagonal staircase!");
+      }
+    }
+
+    //Test batch flood fill, the third seed is inside the region of the first one
+    std::vector<vpImagePoint> seeds;
+    seeds.push_back(vpImagePoint(2,2));
+    seeds.push_back(vpImagePoint(0,1));
+    seeds.push_back(vpImagePoint(2,3));
+    std::vector<unsigned char> new_values;
+    new_values.push_back(2);
+    new_values.push_back(3);
+    new_values.push_back(4);
+
+    vpImage<unsigned char> I_test_batch(image_data, 8, 8, true), I_check_batch(image_data, 8, 8, true);
+    vp::vpConnectedComponentsStats stats;
+    vp::floodFill(I_test_batch, seeds, new_values, stats, 0, vpImageMorphology::CONNEXITY_4);
+    vp::floodFill(I_check_batch, seeds[0], 0, 2, vpImageMorphology::CONNEXITY_4);
+    vp::floodFill(I_check_batch, seeds[1], 0, 3, vpImageMorphology::CONNEXITY_4);
+    printImage(I_test_batch, "I_test_batch");
+    if (I_test_batch != I_check_batch) {
+      throw vpException(vpException::fatalError, "Problem with the batch vp::floodFill()!");
+    }
+
+    for (size_t k = 0; k < seeds.size(); k++) {
+      unsigned int area = 0, bottom = 0, right = 0;
+      for (unsigned int i = 0; i < I_check_batch.getHeight(); i++) {
+        for (unsigned int j = 0; j < I_check_batch.getWidth(); j++) {
+          if (I_check_batch[i][j] == new_values[k]) {
+            area++;
+            bottom = std::max(bottom, i);
+            right = std::max(right, j);
+          }
+        }
+      }
+
+      if (stats.m_area[k] != area || (area > 0 && (stats.m_bottom[k] != bottom || stats.m_right[k] != right))) {
+        throw vpException(vpException::fatalError, "Problem with the statistics of the batch vp::floodFill()!");
+      }
+    }
+
+    //With a tolerance of 1, the 0 and 1 values are filled from the seed
+    vpImage<unsigned char> I_test_tolerance(image_data, 8, 8, true);
+    vp::floodFill(I_test_tolerance, std::vector<vpImagePoint>(1, vpImagePoint(2,2)), std::vector<unsigned char>(1, 2),
+                  stats, 1, vpImageMorphology::CONNEXITY_4);
+    if (stats.m_area[0] != I_test_tolerance.getSize()) {
+      throw vpException(vpException::fatalError, "Problem with the batch vp::floodFill() and a tolerance!");
+    }
+
+    //Nothing is filled when the seed pixel is not equal to the old value
+    vpImage<unsigned char> I_staircase_wrong_seed = I_staircase;
+    vp::floodFill(I_staircase_wrong_seed, vpImagePoint(0,1), 0, 1, vpImageMorphology::CONNEXITY_8);
+    if (I_staircase_wrong_seed != I_staircase) {
+      throw vpException(vpException::fatalError, "Problem with vp::floodFill() and a seed not equal to the old value!");
+    }
+
 
     //Read Klimt.ppm
     filename = vpIoTools::createFilePath(ipath, "ViSP-images/Klimt/Klimt.pgm");
@@ -339,6 +410,24 @@ main(int argc, const char ** argv)
     filename = vpIoTools::createFilePath(opath, "Klimt_flood_fill_8_connexity.pgm");
     vpImageIo::write(I_klimt_flood_fill_8_connexity, filename);
 
+    //Flood fill in a mask, the source image is not modified
+    vpImage<unsigned char> I_klimt_copy = I_klimt, I_klimt_mask;
+    vp::vpBitMask klimt_bit_mask;
+    vp::floodFill(I_klimt, I_klimt_mask, vpImagePoint(seed_y, seed_x), 0, 255, vpImageMorphology::CONNEXITY_8);
+    vp::floodFill(I_klimt, klimt_bit_mask, vpImagePoint(seed_y, seed_x), 0, vpImageMorphology::CONNEXITY_8);
+    if (I_klimt != I_klimt_copy) {
+      throw vpException(vpException::fatalError, "The source image is modified by vp::floodFill() with a mask!");
+    }
+
+    vpImage<unsigned char> I_klimt_bit_mask;
+    klimt_bit_mask.convert(I_klimt_bit_mask);
+    for (unsigned int cpt = 0; cpt < I_klimt.getSize(); cpt++) {
+      bool filled = I_klimt.bitmap[cpt] == 0 && I_klimt_flood_fill_8_connexity.bitmap[cpt] == 255;
+      if ((I_klimt_mask.bitmap[cpt] == 255) != filled || I_klimt_bit_mask.bitmap[cpt] != I_klimt_mask.bitmap[cpt]) {
+        throw vpException(vpException::fatalError, "Problem with vp::floodFill() with a mask!");
+      }
+    }
+
 
 #if VISP_HAVE_OPENCV_VERSION >= 0x020408
     cv::Mat matImg_klimt_4_connexity, matImg_klimt_8_connexity;
@@ -36,11 +36,14 @@
  *****************************************************************************/
 
 #include <visp3/core/vpImage.h>
+#include <visp3/core/vpImageConvert.h>
+#include <visp3/core/vpImageMorphology.h>
 #include <visp3/io/vpImageIo.h>
 #include <visp3/io/vpParseArgv.h>
 #include <visp3/core/vpIoTools.h>
 #include <visp3/core/vpMath.h>
 #include <visp3/imgproc/vpImgproc.h>
+#include <visp3/imgproc/vpCLAHEContext.h>
 #include <cstdlib>
 #include <cstdio>
 
@@ -140,6 +143,80 @@ bool getOptions(int argc, const char **argv, std::string &ipath, std::string &op
   return true;
 }
 
+/*
+  Exact CLAHE computed as in the original implementation: the histogram of the window around each pixel is built
+  densely, clipped iteratively and integrated for each pixel.
+
+  \param I1 : Input image.
+  \param I2 : Output image.
+  \param blockRadius : Radius of the block around each pixel.
+  \param bins : Number of histogram bins.
+  \param slope : Clip slope.
+  \param maxValue : Maximum value of the image type.
+ */
+template<typename Type>
+void claheExactReference(const vpImage<Type> &I1, vpImage<Type> &I2, const int blockRadius, const int bins,
+                         const float slope, const float maxValue)
+{
+  int height = (int) I1.getHeight(), width = (int) I1.getWidth(), histlength = bins + 1;
+  std::vector<int> hist((size_t) histlength);
+  I2.resize(I1.getHeight(), I1.getWidth());
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      int yMin = std::max(0, y - blockRadius), yMax = std::min(height, y + blockRadius + 1);
+      int xMin = std::max(0, x - blockRadius), xMax = std::min(width, x + blockRadius + 1);
+
+      std::fill(hist.begin(), hist.end(), 0);
+      for (int yi = yMin; yi < yMax; yi++) {
+        for (int xi = xMin; xi < xMax; xi++) {
+          hist[(size_t) (int) (I1[yi][xi] / maxValue * bins + 0.5f)]++;
+        }
+      }
+
+      int n = (yMax - yMin) * (xMax - xMin);
+      int limit = (int) (slope * n / bins + 0.5f);
+      int clippedEntries = 0, clippedEntriesBefore = 0;
+      do {
+        clippedEntriesBefore = clippedEntries;
+        clippedEntries = 0;
+        for (int i = 0; i < histlength; i++) {
+          if (hist[(size_t) i] > limit) {
+            clippedEntries += hist[(size_t) i] - limit;
+            hist[(size_t) i] = limit;
+          }
+        }
+
+        int m = clippedEntries % histlength;
+        for (int i = 0; i < histlength; i++) {
+          hist[(size_t) i] += clippedEntries / histlength;
+        }
+        if (m != 0) {
+          for (int i = (histlength - 1) / m / 2; i < histlength; i += (histlength - 1) / m) {
+            hist[(size_t) i]++;
+          }
+        }
+      } while (clippedEntries != clippedEntriesBefore);
+
+      int hMin = 0;
+      while (hist[(size_t) hMin] == 0) {
+        hMin++;
+      }
+      int v = (int) (I1[y][x] / maxValue * bins + 0.5f);
+      int cdf = 0, cdfV = 0;
+      for (int i = hMin; i < histlength; i++) {
+        cdf += hist[(size_t) i];
+        if (i == v) {
+          cdfV = cdf;
+        }
+      }
+
+      float t = (cdfV - hist[(size_t) hMin]) / (float) (cdf - hist[(size_t) hMin]);
+      I2[y][x] = (Type) (int) (t * maxValue + 0.5f);
+    }
+  }
+}
+
 int
 main(int argc, const char ** argv)
 {
@@ -289,6 +366,173 @@ main(int argc, const char ** argv)
     filename = vpIoTools::createFilePath(opath, "Klimt_retinex.ppm");
     vpImageIo::write(I_color_retinex, filename);
 
+    //Retinex with the recursive Gaussian blur
+    vpImage<vpRGBa> I_color_retinex_recursive;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_recursive, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_RECURSIVE);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color retinex with the recursive Gaussian blur: " << t << " ms" << std::endl;
+
+    filename = vpIoTools::createFilePath(opath, "Klimt_retinex_recursive.ppm");
+    vpImageIo::write(I_color_retinex_recursive, filename);
+
+    //Compare both blur methods with a kernel covering +/- 3 sigma
+    vp::retinex(I_color, I_color_retinex, 16, 1, vp::RETINEX_UNIFORM, 1.2, 49);
+    vp::retinex(I_color, I_color_retinex_recursive, 16, 1, vp::RETINEX_UNIFORM, 1.2, 49, vp::RETINEX_BLUR_RECURSIVE);
+    double retinex_mean_error = 0.0;
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      retinex_mean_error += std::fabs((double) I_color_retinex.bitmap[cpt].R - I_color_retinex_recursive.bitmap[cpt].R) +
+          std::fabs((double) I_color_retinex.bitmap[cpt].G - I_color_retinex_recursive.bitmap[cpt].G) +
+          std::fabs((double) I_color_retinex.bitmap[cpt].B - I_color_retinex_recursive.bitmap[cpt].B);
+    }
+    retinex_mean_error /= 3.0 * I_color.getSize();
+    std::cout << "Retinex mean absolute difference between kernel and recursive blur: " << retinex_mean_error << std::endl;
+    if (retinex_mean_error > 2.0) {
+      throw vpException(vpException::fatalError, "Problem with the recursive Gaussian blur in retinex!");
+    }
+
+    //Retinex with the Gaussian pyramid
+    vpImage<vpRGBa> I_color_retinex_pyramid;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_pyramid, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color retinex with the Gaussian pyramid: " << t << " ms" << std::endl;
+
+    filename = vpIoTools::createFilePath(opath, "Klimt_retinex_pyramid.ppm");
+    vpImageIo::write(I_color_retinex_pyramid, filename);
+
+    //Compare the pyramid and the recursive blurs
+    vp::retinex(I_color, I_color_retinex_recursive, 16, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_RECURSIVE);
+    vp::retinex(I_color, I_color_retinex_pyramid, 16, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID);
+    retinex_mean_error = 0.0;
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      retinex_mean_error += std::fabs((double) I_color_retinex_recursive.bitmap[cpt].R - I_color_retinex_pyramid.bitmap[cpt].R) +
+          std::fabs((double) I_color_retinex_recursive.bitmap[cpt].G - I_color_retinex_pyramid.bitmap[cpt].G) +
+          std::fabs((double) I_color_retinex_recursive.bitmap[cpt].B - I_color_retinex_pyramid.bitmap[cpt].B);
+    }
+    retinex_mean_error /= 3.0 * I_color.getSize();
+    std::cout << "Retinex mean absolute difference between recursive and pyramid blur: " << retinex_mean_error << std::endl;
+    if (retinex_mean_error > 2.0) {
+      throw vpException(vpException::fatalError, "Problem with the Gaussian pyramid blur in retinex!");
+    }
+
+    //Retinex in single precision
+    vpImage<vpRGBa> I_color_retinex_float;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_float, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID, true);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color retinex with the Gaussian pyramid in single precision: " << t << " ms" << std::endl;
+
+    vp::retinex(I_color, I_color_retinex_pyramid, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID);
+    retinex_mean_error = 0.0;
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      retinex_mean_error += std::fabs((double) I_color_retinex_pyramid.bitmap[cpt].R - I_color_retinex_float.bitmap[cpt].R) +
+          std::fabs((double) I_color_retinex_pyramid.bitmap[cpt].G - I_color_retinex_float.bitmap[cpt].G) +
+          std::fabs((double) I_color_retinex_pyramid.bitmap[cpt].B - I_color_retinex_float.bitmap[cpt].B);
+    }
+    retinex_mean_error /= 3.0 * I_color.getSize();
+    std::cout << "Retinex mean absolute difference between double and single precision: " << retinex_mean_error << std::endl;
+    if (retinex_mean_error > 0.1) {
+      throw vpException(vpException::fatalError, "Problem with retinex in single precision!");
+    }
+
+    //Same with the kernel blur, blurred in single precision
+    vp::retinex(I_color, I_color_retinex_float, 16, 1, vp::RETINEX_UNIFORM, 1.2, 49, vp::RETINEX_BLUR_KERNEL, true);
+    retinex_mean_error = 0.0;
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      retinex_mean_error += std::fabs((double) I_color_retinex.bitmap[cpt].R - I_color_retinex_float.bitmap[cpt].R) +
+          std::fabs((double) I_color_retinex.bitmap[cpt].G - I_color_retinex_float.bitmap[cpt].G) +
+          std::fabs((double) I_color_retinex.bitmap[cpt].B - I_color_retinex_float.bitmap[cpt].B);
+    }
+    retinex_mean_error /= 3.0 * I_color.getSize();
+    std::cout << "Retinex mean absolute difference between double and single precision kernel blur: "
+              << retinex_mean_error << std::endl;
+    if (retinex_mean_error > 0.1) {
+      throw vpException(vpException::fatalError, "Problem with retinex in single precision with the kernel blur!");
+    }
+
+    //Retinex with the channel and scale blurs run in parallel, the result must not depend on the number of threads
+    vpImage<vpRGBa> I_color_retinex_threads;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_threads, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID,
+                false, 0);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color retinex with the Gaussian pyramid and all the threads: " << t << " ms" << std::endl;
+    if (I_color_retinex_threads != I_color_retinex_pyramid) {
+      throw vpException(vpException::fatalError, "Multithreaded retinex result is different from the single thread result!");
+    }
+
+    //Retinex with 1% percentile clipping, about 1% of the values must be saturated on each side
+    vpImage<vpRGBa> I_color_retinex_clip;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_clip, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID,
+                false, 1, 1.0);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color retinex with percentile clipping: " << t << " ms" << std::endl;
+
+    filename = vpIoTools::createFilePath(opath, "Klimt_retinex_clip.ppm");
+    vpImageIo::write(I_color_retinex_clip, filename);
+
+    unsigned int nb_clipped_low = 0, nb_clipped_high = 0;
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      unsigned char values[3] = {I_color_retinex_clip.bitmap[cpt].R, I_color_retinex_clip.bitmap[cpt].G,
+                                 I_color_retinex_clip.bitmap[cpt].B};
+      for (int c = 0; c < 3; c++) {
+        nb_clipped_low += values[c] == 0 ? 1 : 0;
+        nb_clipped_high += values[c] == 255 ? 1 : 0;
+      }
+    }
+    if (nb_clipped_low > 0.02 * 3 * I_color.getSize() || nb_clipped_high > 0.02 * 3 * I_color.getSize()) {
+      throw vpException(vpException::fatalError, "Problem with the retinex percentile clipping!");
+    }
+
+    //Benchmark the kernel blur for several kernel sizes against the recursive blur, whose cost does not depend on
+    //the kernel size
+    t = vpTime::measureTimeMs();
+    vp::retinex(I_color, I_color_retinex_recursive, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_RECURSIVE);
+    double t_retinex_recursive = vpTime::measureTimeMs() - t;
+    int retinex_benchmark_kernel_sizes[3] = {31, 101, 201};
+    for (int i = 0; i < 3; i++) {
+      t = vpTime::measureTimeMs();
+      vp::retinex(I_color, I_color_retinex, 240, 3, vp::RETINEX_UNIFORM, 1.2, retinex_benchmark_kernel_sizes[i]);
+      t = vpTime::measureTimeMs() - t;
+      std::cout << "Time to do color retinex with kernelSize=" << retinex_benchmark_kernel_sizes[i] << ": " << t
+                << " ms, with the recursive blur: " << t_retinex_recursive << " ms (speedup: "
+                << t / t_retinex_recursive << ")" << std::endl;
+    }
+
+    //The kernel blur gets closer to the recursive blur as the kernel size grows, checked on a crop
+    vpImage<vpRGBa> I_color_crop(64, 80), I_color_crop_retinex, I_color_crop_retinex_recursive;
+    for (unsigned int i = 0; i < I_color_crop.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_color_crop.getWidth(); j++) {
+        I_color_crop[i][j] = I_color[i + I_color.getHeight()/2][j + I_color.getWidth()/2];
+      }
+    }
+
+    vp::retinex(I_color_crop, I_color_crop_retinex_recursive, 16, 1, vp::RETINEX_UNIFORM, 1.2, -1,
+                vp::RETINEX_BLUR_RECURSIVE);
+    int retinex_kernel_sizes[] = {9, 25, 49};
+    double retinex_previous_error = 255.0;
+    for (size_t i = 0; i < sizeof(retinex_kernel_sizes) / sizeof(retinex_kernel_sizes[0]); i++) {
+      vp::retinex(I_color_crop, I_color_crop_retinex, 16, 1, vp::RETINEX_UNIFORM, 1.2, retinex_kernel_sizes[i]);
+
+      double retinex_crop_error = 0.0;
+      for (unsigned int cpt = 0; cpt < I_color_crop.getSize(); cpt++) {
+        retinex_crop_error += std::fabs((double) I_color_crop_retinex.bitmap[cpt].R - I_color_crop_retinex_recursive.bitmap[cpt].R) +
+            std::fabs((double) I_color_crop_retinex.bitmap[cpt].G - I_color_crop_retinex_recursive.bitmap[cpt].G) +
+            std::fabs((double) I_color_crop_retinex.bitmap[cpt].B - I_color_crop_retinex_recursive.bitmap[cpt].B);
+      }
+      retinex_crop_error /= 3.0 * I_color_crop.getSize();
+      std::cout << "Retinex mean absolute difference with the recursive blur for kernelSize="
+                << retinex_kernel_sizes[i] << ": " << retinex_crop_error << std::endl;
+      if (retinex_crop_error > retinex_previous_error) {
+        throw vpException(vpException::fatalError, "Problem with the kernel size in retinex!");
+      }
+      retinex_previous_error = retinex_crop_error;
+    }
+    if (retinex_previous_error > 2.0) {
+      throw vpException(vpException::fatalError, "Problem with the kernel size in retinex!");
+    }
 
     //Stretch contrast
     vpImage<vpRGBa> I_color_stretch_contrast;
@@ -337,6 +581,79 @@ main(int argc, const char ** argv)
     filename = vpIoTools::createFilePath(opath, "Klimt_CLAHE.ppm");
     vpImageIo::write(I_color_clahe, filename);
 
+    //The single pass over the interleaved image must give the same result than the CLAHE on each channel
+    vpImage<unsigned char> I_clahe_R, I_clahe_G, I_clahe_B, I_clahe_A;
+    vpImage<vpRGBa> I_color_clahe_channels;
+    vpImageConvert::split(I_color, &I_clahe_R, &I_clahe_G, &I_clahe_B, &I_clahe_A);
+    vp::clahe(I_clahe_R, I_clahe_R);
+    vp::clahe(I_clahe_G, I_clahe_G);
+    vp::clahe(I_clahe_B, I_clahe_B);
+    vpImageConvert::merge(&I_clahe_R, &I_clahe_G, &I_clahe_B, &I_clahe_A, I_color_clahe_channels);
+    if (I_color_clahe != I_color_clahe_channels) {
+      throw vpException(vpException::fatalError, "Color CLAHE result is different from the CLAHE on each channel!");
+    }
+
+    //Same check with the exact version on a crop
+    vpImage<vpRGBa> I_color_crop_clahe(60, 80), I_color_crop_clahe_exact, I_color_crop_clahe_channels;
+    for (unsigned int i = 0; i < I_color_crop_clahe.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_color_crop_clahe.getWidth(); j++) {
+        I_color_crop_clahe[i][j] = I_color[i + I_color.getHeight()/2][j + I_color.getWidth()/2];
+      }
+    }
+
+    vpImage<unsigned char> I_clahe_R_exact, I_clahe_G_exact, I_clahe_B_exact;
+    vp::clahe(I_color_crop_clahe, I_color_crop_clahe_exact, 9, 256, 3.0f, false);
+    vpImageConvert::split(I_color_crop_clahe, &I_clahe_R, &I_clahe_G, &I_clahe_B, &I_clahe_A);
+    vp::clahe(I_clahe_R, I_clahe_R_exact, 9, 256, 3.0f, false);
+    vp::clahe(I_clahe_G, I_clahe_G_exact, 9, 256, 3.0f, false);
+    vp::clahe(I_clahe_B, I_clahe_B_exact, 9, 256, 3.0f, false);
+    vpImageConvert::merge(&I_clahe_R_exact, &I_clahe_G_exact, &I_clahe_B_exact, &I_clahe_A,
+                          I_color_crop_clahe_channels);
+    if (I_color_crop_clahe_exact != I_color_crop_clahe_channels) {
+      throw vpException(vpException::fatalError, "Color exact CLAHE result is different from the CLAHE on each channel!");
+    }
+
+    //In place, without copy with the fast version
+    vpImage<vpRGBa> I_color_clahe_in_place = I_color;
+    vp::clahe(I_color_clahe_in_place, I_color_clahe_in_place);
+    vp::clahe(I_color_crop_clahe, I_color_crop_clahe, 9, 256, 3.0f, false);
+    if (I_color_clahe_in_place != I_color_clahe || I_color_crop_clahe != I_color_crop_clahe_exact) {
+      throw vpException(vpException::fatalError, "In place color CLAHE result is different!");
+    }
+
+
+    //CLAHE HSV
+    vpImage<vpRGBa> I_color_clahe_HSV;
+    t = vpTime::measureTimeMs();
+    vp::clahe(I_color, I_color_clahe_HSV, 150, 256, 3.0f, true, 0, true);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do color HSV CLAHE: " << t << " ms" << std::endl;
+
+    //The hue of the non-gray pixels must be preserved, the rounding of the RGB channels changes the hue by at most
+    //1/(3*(max-min)) with the max and min of the output RGB channels
+    std::vector<double> hue((size_t) I_color.getSize()), saturation((size_t) I_color.getSize()),
+        value((size_t) I_color.getSize());
+    std::vector<double> hue_HSV((size_t) I_color.getSize()), saturation_HSV((size_t) I_color.getSize()),
+        value_HSV((size_t) I_color.getSize());
+    vpImageConvert::RGBaToHSV((unsigned char *) I_color.bitmap, &hue[0], &saturation[0], &value[0], I_color.getSize());
+    vpImageConvert::RGBaToHSV((unsigned char *) I_color_clahe_HSV.bitmap, &hue_HSV[0], &saturation_HSV[0],
+                             &value_HSV[0], I_color.getSize());
+    for (unsigned int cpt = 0; cpt < I_color.getSize(); cpt++) {
+      const vpRGBa &rgba = I_color_clahe_HSV.bitmap[cpt];
+      int chroma = std::max(rgba.R, std::max(rgba.G, rgba.B)) - std::min(rgba.R, std::min(rgba.G, rgba.B));
+      if (saturation[cpt] > 0.0 && chroma > 0) {
+        double hue_error = std::fabs(hue_HSV[cpt] - hue[cpt]);
+        hue_error = std::min(hue_error, 1.0 - hue_error);
+        if (hue_error > 1.0 / (3.0 * chroma) + 1e-9) {
+          throw vpException(vpException::fatalError, "Color HSV CLAHE does not preserve the hue!");
+        }
+      }
+    }
+
+    //Save CLAHE HSV
+    filename = vpIoTools::createFilePath(opath, "Klimt_CLAHE_HSV.ppm");
+    vpImageIo::write(I_color_clahe_HSV, filename);
+
 
 
     //
@@ -389,6 +706,33 @@ main(int argc, const char ** argv)
     vpImageIo::write(I_gamma_correction, filename);
 
 
+    //Retinex
+    vpImage<unsigned char> I_retinex;
+    t = vpTime::measureTimeMs();
+    vp::retinex(I, I_retinex, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do grayscale retinex: " << t << " ms" << std::endl;
+
+    //Save retinex
+    filename = vpIoTools::createFilePath(opath, "image0000_retinex.pgm");
+    vpImageIo::write(I_retinex, filename);
+
+    //Grayscale, color and intensity only retinex must give the same result on a gray color image
+    vpImage<vpRGBa> I_gray_color(I.getHeight(), I.getWidth()), I_gray_color_retinex, I_gray_intensity_retinex;
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      I_gray_color.bitmap[i] = vpRGBa(I.bitmap[i], I.bitmap[i], I.bitmap[i]);
+    }
+    vp::retinex(I_gray_color, I_gray_color_retinex, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID);
+    vp::retinex(I_gray_color, I_gray_intensity_retinex, 240, 3, vp::RETINEX_UNIFORM, 1.2, -1, vp::RETINEX_BLUR_PYRAMID,
+                false, 1, 0.0, true);
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      if (std::abs((int) I_retinex.bitmap[i] - (int) I_gray_color_retinex.bitmap[i].R) > 1 ||
+          std::abs((int) I_retinex.bitmap[i] - (int) I_gray_intensity_retinex.bitmap[i].G) > 1) {
+        throw vpException(vpException::fatalError, "Grayscale retinex result is different from the color result!");
+      }
+    }
+
+
     //Stretch contrast
     vpImage<unsigned char> I_stretch_contrast;
     t = vpTime::measureTimeMs();
@@ -425,6 +769,198 @@ main(int argc, const char ** argv)
     vpImageIo::write(I_clahe, filename);
 
 
+    //CLAHE exact
+    vpImage<unsigned char> I_clahe_exact;
+    t = vpTime::measureTimeMs();
+    vp::clahe(I, I_clahe_exact, 150, 256, 3.0f, false);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do grayscale exact CLAHE: " << t << " ms" << std::endl;
+
+    //Save CLAHE exact
+    filename = vpIoTools::createFilePath(opath, "image0000_CLAHE_exact.pgm");
+    vpImageIo::write(I_clahe_exact, filename);
+
+    //CLAHE exact must not depend on the number of threads
+    vpImage<unsigned char> I_clahe_exact_all_threads;
+    t = vpTime::measureTimeMs();
+    vp::clahe(I, I_clahe_exact_all_threads, 150, 256, 3.0f, false, 0);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do grayscale exact CLAHE (all threads): " << t << " ms" << std::endl;
+
+    if (I_clahe_exact_all_threads != I_clahe_exact) {
+      throw vpException(vpException::fatalError, "Exact CLAHE result depends on the number of threads!");
+    }
+
+    //Exact CLAHE compared with a dense histogram on a crop, the small radii clip the windows at the border and the
+    //small slopes make the clipping redistribute entries
+    vpImage<unsigned char> I_crop(60, 80), I_clahe_exact_crop, I_clahe_exact_crop_check;
+    for (unsigned int i = 0; i < I_crop.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_crop.getWidth(); j++) {
+        I_crop[i][j] = I[i + I.getHeight()/2][j + I.getWidth()/2];
+      }
+    }
+
+    int clahe_exact_radii[2] = {3, 9};
+    int clahe_exact_bins[3] = {256, 100, 64};
+    float clahe_exact_slopes[2] = {1.5f, 3.0f};
+    for (int r = 0; r < 2; r++) {
+      for (int b = 0; b < 3; b++) {
+        for (int s = 0; s < 2; s++) {
+          vp::clahe(I_crop, I_clahe_exact_crop, clahe_exact_radii[r], clahe_exact_bins[b], clahe_exact_slopes[s], false);
+          claheExactReference(I_crop, I_clahe_exact_crop_check, clahe_exact_radii[r], clahe_exact_bins[b],
+                              clahe_exact_slopes[s], 255.0f);
+          if (I_clahe_exact_crop != I_clahe_exact_crop_check) {
+            throw vpException(vpException::fatalError, "Exact CLAHE result is different from the dense histogram result!");
+          }
+        }
+      }
+    }
+
+    //CLAHE context, must give the same result than vp::clahe()
+    vp::vpCLAHEContext clahe_context(I.getWidth(), I.getHeight());
+    vpImage<unsigned char> I_clahe_context;
+    clahe_context.apply(I, I_clahe_context);
+    t = vpTime::measureTimeMs();
+    clahe_context.apply(I, I_clahe_context);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do grayscale CLAHE with a context: " << t << " ms" << std::endl;
+
+    if (I_clahe_context != I_clahe) {
+      throw vpException(vpException::fatalError, "CLAHE context result is different from vp::clahe()!");
+    }
+
+    //CLAHE context in place
+    vp::vpCLAHEContext clahe_context_in_place(I.getWidth(), I.getHeight());
+    vpImage<unsigned char> I_clahe_in_place = I;
+    clahe_context_in_place.apply(I_clahe_in_place, I_clahe_in_place);
+    if (I_clahe_in_place != I_clahe) {
+      throw vpException(vpException::fatalError, "In place CLAHE context result is different from vp::clahe()!");
+    }
+
+    //CLAHE benchmark with 256 and 64 bins
+    int clahe_bins[2] = {256, 64};
+    for (int i = 0; i < 2; i++) {
+      vpImage<unsigned char> I_clahe_bins;
+      const int nb_iterations = 10;
+
+      //Histogram pass with the float quantization of the pixels compared with the bin lookup table
+      std::vector<int> hist_float((size_t) (clahe_bins[i] + 1), 0), hist_lut((size_t) (clahe_bins[i] + 1), 0);
+      t = vpTime::measureTimeMs();
+      for (int iter = 0; iter < nb_iterations; iter++) {
+        for (unsigned int cpt = 0; cpt < I.getSize(); cpt++) {
+          hist_float[(size_t) (int) (I.bitmap[cpt] / 255.0f * clahe_bins[i] + 0.5f)]++;
+        }
+      }
+      t = (vpTime::measureTimeMs() - t) / nb_iterations;
+      std::cout << "Mean time to do a histogram pass with float quantization (" << clahe_bins[i] << " bins): " << t
+                << " ms" << std::endl;
+
+      std::vector<int> bin_lut(256);
+      for (int value = 0; value < 256; value++) {
+        bin_lut[(size_t) value] = (int) (value / 255.0f * clahe_bins[i] + 0.5f);
+      }
+      t = vpTime::measureTimeMs();
+      for (int iter = 0; iter < nb_iterations; iter++) {
+        for (unsigned int cpt = 0; cpt < I.getSize(); cpt++) {
+          hist_lut[(size_t) bin_lut[I.bitmap[cpt]]]++;
+        }
+      }
+      t = (vpTime::measureTimeMs() - t) / nb_iterations;
+      std::cout << "Mean time to do a histogram pass with the bin lookup table (" << clahe_bins[i] << " bins): " << t
+                << " ms" << std::endl;
+
+      if (hist_float != hist_lut) {
+        throw vpException(vpException::fatalError, "The bin lookup table is different from the float quantization!");
+      }
+
+      t = vpTime::measureTimeMs();
+      for (int iter = 0; iter < nb_iterations; iter++) {
+        vp::clahe(I, I_clahe_bins, 150, clahe_bins[i], 3.0f, true);
+      }
+      t = (vpTime::measureTimeMs() - t) / nb_iterations;
+      std::cout << "Mean time to do grayscale CLAHE (" << clahe_bins[i] << " bins): " << t << " ms" << std::endl;
+
+      t = vpTime::measureTimeMs();
+      for (int iter = 0; iter < nb_iterations; iter++) {
+        vp::clahe(I, I_clahe_bins, 150, clahe_bins[i], 3.0f, false);
+      }
+      t = (vpTime::measureTimeMs() - t) / nb_iterations;
+      std::cout << "Mean time to do grayscale exact CLAHE (" << clahe_bins[i] << " bins): " << t << " ms" << std::endl;
+    }
+
+    //CLAHE on 16-bit image, must be consistent with the 8-bit result
+    vpImage<unsigned short> I_16bit(I.getHeight(), I.getWidth()), I_clahe_16bit;
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      I_16bit.bitmap[i] = (unsigned short) (I.bitmap[i] * 257);
+    }
+    t = vpTime::measureTimeMs();
+    vp::clahe(I_16bit, I_clahe_16bit, 150, 256, 3.0f);
+    t = vpTime::measureTimeMs() - t;
+    std::cout << "Time to do 16-bit grayscale CLAHE: " << t << " ms" << std::endl;
+
+    for (unsigned int i = 0; i < I.getSize(); i++) {
+      if (std::abs(vpMath::round(I_clahe_16bit.bitmap[i] / 257.0) - I_clahe.bitmap[i]) > 1) {
+        throw vpException(vpException::fatalError, "16-bit CLAHE result is different from the 8-bit result!");
+      }
+    }
+
+    //More than 4096 bins are rejected by both versions
+    vpImage<unsigned short> I_clahe_16bit_too_many_bins;
+    vp::clahe(I_16bit, I_clahe_16bit_too_many_bins, 150, 8192, 3.0f, true);
+    vp::clahe(I_16bit, I_clahe_16bit_too_many_bins, 150, 8192, 3.0f, false);
+    if (I_clahe_16bit_too_many_bins.getSize() != 0) {
+      throw vpException(vpException::fatalError, "16-bit CLAHE accepts more than 4096 bins!");
+    }
+
+    //Exact CLAHE on 16-bit image with more than 256 bins, compared with a dense histogram on a noisy crop
+    vpImage<unsigned short> I_16bit_crop(48, 64), I_clahe_16bit_exact, I_clahe_16bit_exact_check;
+    for (unsigned int i = 0; i < I_16bit_crop.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_16bit_crop.getWidth(); j++) {
+        I_16bit_crop[i][j] = (unsigned short) std::min(65535u, I_16bit[i + I.getHeight()/2][j + I.getWidth()/2] + (i*31 + j*17) % 257);
+      }
+    }
+
+    int clahe_16bit_bins[2] = {1024, 4096};
+    for (int i = 0; i < 2; i++) {
+      vp::clahe(I_16bit_crop, I_clahe_16bit_exact, 7, clahe_16bit_bins[i], 3.0f, false);
+      claheExactReference(I_16bit_crop, I_clahe_16bit_exact_check, 7, clahe_16bit_bins[i], 3.0f, 65535.0f);
+      if (I_clahe_16bit_exact != I_clahe_16bit_exact_check) {
+        throw vpException(vpException::fatalError, "16-bit exact CLAHE result is different from the dense histogram result!");
+      }
+    }
+
+
+    //Morphological reconstruction, must be equal to the iterated geodesic dilatations
+    vpImage<unsigned char> I_mask(64, 64), I_marker(64, 64), I_reconstruct;
+    for (unsigned int i = 0; i < I_mask.getHeight(); i++) {
+      for (unsigned int j = 0; j < I_mask.getWidth(); j++) {
+        I_mask[i][j] = I[i + I.getHeight()/2][j + I.getWidth()/2];
+        I_marker[i][j] = (i*I_mask.getWidth() + j) % 97 == 0 ? 255 : (unsigned char) std::max(0, I_mask[i][j] - 40);
+      }
+    }
+
+    for (int cpt = 0; cpt < 2; cpt++) {
+      vpImageMorphology::vpConnexityType connexity = cpt == 0 ? vpImageMorphology::CONNEXITY_4 : vpImageMorphology::CONNEXITY_8;
+      vpImage<unsigned char> I_reconstruct_check = I_marker, I_previous;
+      do {
+        I_previous = I_reconstruct_check;
+        vpImageMorphology::dilatation(I_reconstruct_check, connexity);
+        for (unsigned int i = 0; i < I_mask.getSize(); i++) {
+          I_reconstruct_check.bitmap[i] = std::min(I_reconstruct_check.bitmap[i], I_mask.bitmap[i]);
+        }
+      } while (I_reconstruct_check != I_previous);
+
+      t = vpTime::measureTimeMs();
+      vp::reconstruct(I_marker, I_mask, I_reconstruct, connexity);
+      t = vpTime::measureTimeMs() - t;
+      std::cout << "Time to do grayscale reconstruction (" << (cpt == 0 ? 4 : 8) << "-connexity): " << t << " ms" << std::endl;
+
+      if (I_reconstruct != I_reconstruct_check) {
+        throw vpException(vpException::fatalError, "Reconstruction result is different from the iterated geodesic dilatations!");
+      }
+    }
+
+
     return EXIT_SUCCESS;
   } catch(const vpException &e) {
     std::cerr << "Catch an exception: " << e.what() << std::endl;
@@ -11,7 +11,6 @@
 #if defined(VISP_HAVE_MODULE_IMGPROC)
 //! [Include]
 #include <visp3/imgproc/vpImgproc.h>
-#include <visp3/core/vpMomentObject.h>
 //! [Include]
 #endif
 
@@ -106,32 +105,19 @@ int main(int argc, char *argv[]) {
   vpDisplay::display(I_draw_contours);
 
   //! [Count coins]
+  vpImage<int> labels;
   int nb_coins = 0;
-  for (size_t i = 0; i < contours.size(); i++) {
-    std::vector<vpPoint> vec_p;
-
-    for (size_t j = 0; j < contours[i].size(); j++) {
-      vpPoint pt;
-      pt.set_x(contours[i][j].get_u());
-      pt.set_y(contours[i][j].get_v());
-      vec_p.push_back(pt);
-    }
-
-    vpMomentObject obj(1);
-    obj.setType(vpMomentObject::DENSE_POLYGON);
-    obj.fromVector(vec_p);
+  vp::vpConnectedComponentsStats stats;
+  vp::connectedComponentsWithStats(I_close, labels, nb_coins, stats, vpImageMorphology::CONNEXITY_8, false,
+                                   I.getSize()/200);
 
-    //sign(m00) depends of the contour orientation (clockwise or counter-clockwise)
-    //that's why we use fabs
-    if (std::fabs(obj.get(0, 0)) >= I.getSize()/200) {
-      nb_coins++;
-      std::stringstream ss;
-      ss << "Coin " << nb_coins;
+  for (int i = 0; i < nb_coins; i++) {
+    std::stringstream ss;
+    ss << "Coin " << i+1;
 
-      double centroid_x = std::fabs(obj.get(1, 0) / obj.get(0, 0));
-      double centroid_y = std::fabs(obj.get(0, 1) / obj.get(0, 0));
-      vpDisplay::displayText(I_draw_contours, centroid_y, centroid_x-20, ss.str(), vpColor::red);
-    }
+    double centroid_i = stats.m_sumI[(size_t) i] / stats.m_area[(size_t) i];
+    double centroid_j = stats.m_sumJ[(size_t) i] / stats.m_area[(size_t) i];
+    vpDisplay::displayText(I_draw_contours, centroid_i, centroid_j-20, ss.str(), vpColor::red);
   }
   //! [Count coins]
 